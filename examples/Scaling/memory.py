@@ -0,0 +1,59 @@
+#!/usr/bin/env python
+
+"""
+Report the peak resident memory of the driver before and after registering a
+large number of tests, along with the tests and the strings the test arena
+holds (pyctest.num_allocated_tests and pyctest.num_interned_strings)
+"""
+
+import os
+import sys
+import argparse
+import resource
+import subprocess
+
+import pyctest.pyctest as pyct
+
+
+def peak_rss():
+    """Peak resident memory of this process in MB"""
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # kilobytes on Linux, bytes on macOS
+    return rss / (1024.0 * 1024.0 if sys.platform == "darwin" else 1024.0)
+
+
+def measure(ntests):
+    before = peak_rss()
+    # one command and the usual properties per test
+    for i in range(ntests):
+        pyct.test("test_{}".format(i), ["true", "--case", "{}".format(i)],
+                  {"LABELS": "unit;fast", "TIMEOUT": "60",
+                   "WORKING_DIRECTORY": os.getcwd()})
+    after = peak_rss()
+    per_test = (after - before) * 1024.0 * 1024.0 / max(ntests, 1)
+    print("{:>10} {:>12.1f} {:>12.1f} {:>12.0f} {:>10} {:>10}".format(
+        ntests, before, after, per_test, pyct.num_allocated_tests(),
+        pyct.num_interned_strings()))
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-n", "--tests", type=int, nargs="+",
+                        default=[10000, 100000], help="Numbers of tests")
+    parser.add_argument("--single", action="store_true",
+                        help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.single:
+        measure(args.tests[0])
+        sys.exit(0)
+
+    print("{:>10} {:>12} {:>12} {:>12} {:>10} {:>10}".format(
+        "tests", "before (MB)", "after (MB)", "bytes/test", "allocated",
+        "interned"))
+    sys.stdout.flush()
+    # the peak only grows, so each size is measured in a fresh process
+    for ntests in args.tests:
+        subprocess.check_call([sys.executable, os.path.abspath(__file__),
+                               "--single", "-n", "{}".format(ntests)])
@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+
+"""
+Time the start-up of CTest with a large CTestTestfile.cmake against loading
+the same tests from the compact CTestTestfile.manifest
+"""
+
+import os
+import sys
+import time
+import argparse
+import subprocess
+
+import pyctest.pyctest as pyct
+
+
+def elapsed(func):
+    beg = time.time()
+    func()
+    return time.time() - beg
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-n", "--tests", type=int, nargs="+",
+                        default=[10000, 100000], help="Numbers of tests")
+    parser.add_argument("-d", "--directory", type=str,
+                        default=os.path.join(os.getcwd(), "pycm-startup"),
+                        help="Directory of the generated files")
+    args = parser.parse_args()
+
+    pyct.PROJECT_NAME = "PyCTest"
+    pyct.SOURCE_DIRECTORY = os.getcwd()
+
+    print("{:>10} {:>16} {:>16}".format("tests", "ctest -N (s)",
+                                        "manifest (s)"))
+    for ntests in args.tests:
+        directory = os.path.join(args.directory, "{}".format(ntests))
+        if not os.path.exists(directory):
+            os.makedirs(directory)
+        pyct.BINARY_DIRECTORY = directory
+
+        # one command and the usual properties per test
+        pyct.reset_tests()
+        for i in range(ntests):
+            pyct.test("test_{}".format(i), ["true", "--case", "{}".format(i)],
+                      {"LABELS": "unit;fast", "TIMEOUT": "60",
+                       "WORKING_DIRECTORY": directory})
+
+        pyct.generate_test_file(directory, True)
+
+        # CTest parses every add_test and set_tests_properties
+        with open(os.devnull, "w") as devnull:
+            ctest = elapsed(lambda: subprocess.check_call(
+                [pyct.exe_path(), "-N"], cwd=directory, stdout=devnull))
+
+        pyct.reset_tests()
+        manifest = elapsed(lambda: pyct.load_test_manifest(
+            os.path.join(directory, "CTestTestfile.manifest")))
+
+        print("{:>10} {:>16.3f} {:>16.3f}".format(ntests, ctest, manifest))
+        sys.stdout.flush()
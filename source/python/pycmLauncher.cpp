@@ -0,0 +1,2316 @@
+// MIT License
+//
+// Copyright (c) 2018, The Regents of the University of California,
+// through Lawrence Berkeley National Laboratory (subject to receipt of any
+// required approvals from the U.S. Dept. of Energy).  All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+//  pyctest-launcher [<options>] [--] <command> [<arg>...]
+//
+//  Runs a test command and reports the resources it used as CTest
+//  measurements (<DartMeasurement>), which CTest copies into Test.xml:
+//
+//      CPU Time        user + system time of the command and its children (s)
+//      User Time       (s)
+//      System Time     (s)
+//      Peak RSS        largest resident set of the command or a child (MiB)
+//      Read Bytes      bytes read from block devices
+//      Write Bytes     bytes written to block devices
+//
+//  The accounting comes from the rusage of the terminated command so the only
+//  overhead is one fork. The exit code (or the terminating signal) of the
+//  command is passed on to CTest unchanged
+//
+//  With --repeat the command is run as a benchmark (see pyctest.benchmark):
+//
+//      --repeat <N>        number of timed runs
+//      --warmup <N>        number of untimed runs before them
+//      --cpus <list>       pin the runs to these CPUs, e.g. "0,2-3" (Linux)
+//      --baseline <file>   compare with (or, with --update-baseline, record
+//                          in) this file of "<name>\t<median>\t<MAD>" lines
+//      --name <name>       key of the benchmark in the baseline file
+//      --threshold <f>     relative slowdown of the median that fails the
+//                          test (default: 0.1)
+//      --update-baseline   record the median instead of failing on a
+//                          regression
+//
+//  and reports the Median Time, MAD Time (median absolute deviation), and
+//  Min Time of the timed runs. The test fails if the median is slower than
+//  the baseline by more than the threshold and by more than the noise of the
+//  runs (3 scaled MAD)
+//
+//  With --batch the command is a batch of test cases of one executable (see
+//  pyctest.hpp, pycmTestBatches), run by one process:
+//
+//      --batch <protocol>  "gtest", "catch2", or "pyctest"
+//      --results <file>    file the results of the cases are written to
+//      --cases <N>         the last N arguments are the test cases (the last
+//                          argument of the command of each test)
+//
+//  The results of the cases are recovered from the JUnit XML report of
+//  GoogleTest and Catch2 or, with the "pyctest" protocol, from the results
+//  file the executable writes to the path in PYCTEST_BATCH_RESULTS (see
+//  write_results). If the process crashed, the cases without a result are
+//  run again one at a time. The tests of the cases then report their own
+//  result with:
+//
+//      --batch-result <file> -- <case>
+//
+//  With --pool the command (see pyctest/pool.py) is sent to the pyctest
+//  worker pool listening on the socket in the PYCTEST_POOL environment
+//  variable, together with the working directory, the environment, and the
+//  stdout/stderr of the launcher, and the exit status of the worker is
+//  returned. Without a pool, the command is executed
+//
+//  With --stress the command is run many times at once to reproduce rare
+//  failures such as races (see pyctest.stress_tests):
+//
+//      --stress <N>        number of runs
+//      --jobs <N>          runs at the same time (default: number of CPUs)
+//      --seed <N>          PYCTEST_STRESS_SEED of the first run (default:
+//                          random), run i gets <seed> + i
+//      --jitter <ms>       delay the start of each run by a random time up to
+//                          this long so the runs interleave differently
+//      --keep-going        do not stop at the first failure
+//
+//  Each run gets PYCTEST_STRESS_ITERATION and PYCTEST_STRESS_SEED in its
+//  environment. The runs still going when one fails are killed, and the
+//  number of runs, the failure rate, and the output of the first failing run
+//  are reported
+//
+//  With --fuzz the command is a libFuzzer target (see pyctest.fuzz), run for a
+//  slice of time with a corpus kept between runs:
+//
+//      --fuzz <dir>        corpus of the target, created if missing
+//      --fuzz-time <s>     length of the slice (-max_total_time)
+//      --fuzz-seed <dir>   directory of seed inputs, only read (repeatable)
+//
+//  The inputs found in the slice are written to <dir>.new-<pid> and then
+//  merged (-merge=1) with the corpus into a minimized corpus that replaces
+//  it, so only the inputs that add coverage are kept. Crashing inputs are
+//  saved in <dir>.artifacts and fail the test. They are replayed first by the
+//  next runs, which fail without fuzzing until the inputs pass and join the
+//  corpus. The corpus is locked (<dir>.lock) during the replay and the merge
+//  only. The Corpus Size, New Inputs, and Crashes are reported
+//
+//  With --metric the values printed by the command are reported as
+//  measurements too (see the PYCTEST_METRICS property of the tests):
+//
+//      --metric <rule>     "<name>=<regex>": the first group (or the whole
+//                          match) of the last match of the regular expression
+//                          in a line of output, or "<name>=json:<path>": the
+//                          value at a path of keys and indices, e.g.
+//                          "results[0].time", in the last line of output that
+//                          is a JSON document with it (repeatable)
+//      --metric-store <file>
+//                          append the numeric values to this time series of
+//                          "<time>\t<test>\t<metric>\t<value>" lines
+//      --name <name>       name of the test in the store (default: the
+//                          command)
+//      --no-resources      report the metrics only, not the resources used
+//
+//  The output is passed on as it arrives and the rules are applied to one
+//  line at a time, so it is not kept. Numbers are reported as numeric/double
+//  and anything else as text/string
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#    include <direct.h>
+#    include <fcntl.h>
+#    include <io.h>
+#    include <process.h>
+#    include <sys/stat.h>
+#else
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <sched.h>
+#    include <signal.h>
+#    include <sys/file.h>
+#    include <sys/resource.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/time.h>
+#    include <sys/types.h>
+#    include <sys/un.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+extern char** environ;
+#endif
+
+//============================================================================//
+
+namespace
+{
+typedef std::string                                   string_t;
+typedef std::map<string_t, std::pair<double, double>> baseline_t;
+typedef std::chrono::steady_clock                     clock_type;
+typedef std::chrono::duration<double>                 seconds_type;
+
+const char* launcher_name = "pyctest-launcher";
+
+struct options_t
+{
+    options_t()
+    : repeat(0)
+    , warmup(0)
+    , cases(0)
+    , stress(0)
+    , jobs(0)
+    , seed(0)
+    , threshold(0.1)
+    , jitter(0.0)
+    , fuzz_time(0.0)
+    , update_baseline(false)
+    , pool(false)
+    , keep_going(false)
+    , has_seed(false)
+    , no_resources(false)
+    {
+    }
+
+    unsigned              repeat;
+    unsigned              warmup;
+    unsigned              cases;
+    unsigned              stress;
+    unsigned              jobs;
+    uint64_t              seed;
+    double                threshold;
+    double                jitter;
+    double                fuzz_time;
+    bool                  update_baseline;
+    bool                  pool;
+    bool                  keep_going;
+    bool                  has_seed;
+    bool                  no_resources;
+    std::vector<int>      cpus;
+    string_t              baseline;
+    string_t              name;
+    string_t              batch;
+    string_t              results;
+    string_t              batch_result;
+    string_t              fuzz;
+    std::vector<string_t> fuzz_seeds;
+    std::vector<string_t> metrics;
+    string_t              metric_store;
+};
+
+//----------------------------------------------------------------------------//
+
+void
+measurement(const char* name, double value, int precision = 6)
+{
+    std::stringstream ss;
+    ss << std::setprecision(precision) << value;
+    std::cout << "<DartMeasurement name=\"" << name
+              << "\" type=\"numeric/double\">" << ss.str()
+              << "</DartMeasurement>\n";
+}
+
+//----------------------------------------------------------------------------//
+// "0,2-3" -> { 0, 2, 3 }
+bool
+parse_cpus(const string_t& str, std::vector<int>& cpus)
+{
+    std::stringstream ss(str);
+    string_t          item;
+    while(std::getline(ss, item, ','))
+    {
+        int               lo = 0, hi = 0;
+        char              dash;
+        std::stringstream is(item);
+        if(!(is >> lo))
+            return false;
+        hi = lo;
+        if(is >> dash && (dash != '-' || !(is >> hi)))
+            return false;
+        for(int i = lo; i <= hi; ++i)
+            cpus.push_back(i);
+    }
+    return !cpus.empty();
+}
+
+//----------------------------------------------------------------------------//
+
+double
+median(std::vector<double> values)
+{
+    if(values.empty())
+        return 0.0;
+    auto n = values.size();
+    std::sort(values.begin(), values.end());
+    return (n % 2 == 1) ? values[n / 2]
+                        : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+//----------------------------------------------------------------------------//
+
+const string_t&
+baseline_header()
+{
+    static string_t _instance = "# pyctest-benchmark-baseline 1";
+    return _instance;
+}
+
+bool
+read_baseline(const string_t& fname, baseline_t& baseline)
+{
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    string_t line;
+    while(std::getline(ifs, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        auto mpos = line.find_last_of('\t');
+        if(mpos == string_t::npos || mpos == 0)
+            continue;
+        auto tpos = line.find_last_of('\t', mpos - 1);
+        if(tpos == string_t::npos || tpos == 0)
+            continue;
+        baseline[line.substr(0, tpos)] =
+            std::make_pair(std::atof(line.c_str() + tpos + 1),
+                           std::atof(line.c_str() + mpos + 1));
+    }
+    return true;
+}
+
+bool
+write_baseline(const string_t& fname, const baseline_t& baseline)
+{
+    string_t      tmp = fname + ".tmp";
+    std::ofstream ofs(tmp.c_str());
+    if(!ofs)
+        return false;
+    ofs << baseline_header() << '\n';
+    for(const auto& itr : baseline)
+        ofs << itr.first << '\t' << std::setprecision(9) << itr.second.first
+            << '\t' << itr.second.second << '\n';
+    ofs.close();
+    return ofs && std::rename(tmp.c_str(), fname.c_str()) == 0;
+}
+
+//============================================================================//
+
+#if defined(_WIN32)
+
+typedef int status_t;
+
+// no rusage or CPU pinning on Windows: only the wall-clock time
+status_t
+run_command(char** args, const std::vector<int>&, double& wall, void*,
+            const char* output = nullptr)
+{
+    std::cout.flush();
+    std::cerr.flush();
+    // the child inherits stdout/stderr
+    int _fd = (output) ? _open(output, _O_CREAT | _O_TRUNC | _O_WRONLY,
+                               _S_IREAD | _S_IWRITE)
+                       : -1;
+    int _out = (_fd >= 0) ? _dup(1) : -1;
+    int _err = (_fd >= 0) ? _dup(2) : -1;
+    if(_fd >= 0)
+    {
+        _dup2(_fd, 1);
+        _dup2(_fd, 2);
+        _close(_fd);
+    }
+    auto     beg = clock_type::now();
+    intptr_t ret = _spawnvp(_P_WAIT, args[0], args);
+    wall         = seconds_type(clock_type::now() - beg).count();
+    if(_out >= 0)
+    {
+        _dup2(_out, 1);
+        _dup2(_err, 2);
+        _close(_out);
+        _close(_err);
+    }
+    if(ret < 0)
+    {
+        std::cerr << launcher_name << ": cannot execute \"" << args[0]
+                  << "\": " << strerror(errno) << std::endl;
+        return 127;
+    }
+    return static_cast<status_t>(ret);
+}
+
+bool
+succeeded(status_t status)
+{
+    return status == 0;
+}
+
+int
+exit_code(status_t status)
+{
+    return status;
+}
+
+string_t
+describe_status(status_t status)
+{
+    return "exit code " + std::to_string(status);
+}
+
+void
+set_environment(const char* name, const string_t& value)
+{
+    _putenv_s(name, value.c_str());
+}
+
+class baseline_lock
+{
+public:
+    explicit baseline_lock(const string_t&) {}
+};
+
+// no pool on Windows
+bool
+pool_request(char**, status_t&)
+{
+    return false;
+}
+
+#else
+
+typedef int status_t;
+
+pid_t child_pid = 0;
+
+// CTest stops a test that timed out with SIGTERM/SIGKILL: pass it on
+extern "C" void
+forward_signal(int sig)
+{
+    if(child_pid > 0)
+        kill(child_pid, sig);
+}
+
+double
+to_seconds(const struct timeval& tv)
+{
+    return static_cast<double>(tv.tv_sec) + 1.0e-6 * tv.tv_usec;
+}
+
+// run the command, the usage includes the children the command waited for.
+// The stdout and stderr of the command go to "output" if not null
+status_t
+run_command(char** args, const std::vector<int>& cpus, double& wall,
+            struct rusage* usage, const char* output = nullptr)
+{
+    std::cout.flush();
+    std::cerr.flush();
+    auto beg  = clock_type::now();
+    child_pid = fork();
+    if(child_pid < 0)
+    {
+        perror("fork");
+        return W_EXITCODE(EXIT_FAILURE, 0);
+    }
+
+    if(child_pid == 0)
+    {
+        if(output)
+        {
+            int fd = open(output, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+            if(fd >= 0)
+            {
+                dup2(fd, STDOUT_FILENO);
+                dup2(fd, STDERR_FILENO);
+                close(fd);
+            }
+        }
+#    if defined(__linux__)
+        if(!cpus.empty())
+        {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            for(auto cpu : cpus)
+                CPU_SET(cpu, &mask);
+            if(sched_setaffinity(0, sizeof(mask), &mask) != 0)
+                perror("sched_setaffinity");
+        }
+#    else
+        if(!cpus.empty())
+            std::cerr << launcher_name << ": CPU pinning is not supported"
+                      << std::endl;
+#    endif
+        execvp(args[0], args);
+        std::cerr << launcher_name << ": cannot execute \"" << args[0]
+                  << "\": " << strerror(errno) << std::endl;
+        _exit(127);
+    }
+
+    int status = 0;
+    while(wait4(child_pid, &status, 0, usage) < 0)
+    {
+        if(errno != EINTR)
+        {
+            perror("wait4");
+            return W_EXITCODE(EXIT_FAILURE, 0);
+        }
+    }
+    wall      = seconds_type(clock_type::now() - beg).count();
+    child_pid = 0;
+    return status;
+}
+
+bool
+succeeded(status_t status)
+{
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// exit code of the launcher for the wait status of the command. A command
+// killed by a signal is reported to CTest as killed by the same signal
+int
+exit_code(status_t status)
+{
+    if(WIFSIGNALED(status))
+    {
+        int sig = WTERMSIG(status);
+        signal(sig, SIG_DFL);
+        raise(sig);
+        return 128 + sig;
+    }
+    return (WIFEXITED(status)) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+
+string_t
+describe_status(status_t status)
+{
+    if(WIFSIGNALED(status))
+        return "signal " + std::to_string(WTERMSIG(status));
+    return "exit code " + std::to_string(exit_code(status));
+}
+
+void
+set_environment(const char* name, const string_t& value)
+{
+    setenv(name, value.c_str(), 1);
+}
+
+// benchmarks sharing a baseline file can run at the same time
+class baseline_lock
+{
+public:
+    explicit baseline_lock(const string_t& fname)
+    : m_fd(open((fname + ".lock").c_str(), O_CREAT | O_RDWR, 0644))
+    {
+        if(m_fd >= 0)
+            flock(m_fd, LOCK_EX);
+    }
+    ~baseline_lock()
+    {
+        if(m_fd >= 0)
+            close(m_fd);
+    }
+
+private:
+    int m_fd;
+};
+
+bool
+send_all(int fd, const char* data, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t n = send(fd, data, size, 0);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// send the command to the worker pool and wait for the "exit <code>" or
+// "signal <number>" reply. Returns false if there is no pool to connect to
+bool
+pool_request(char** args, status_t& status)
+{
+    const char* address = getenv("PYCTEST_POOL");
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if(!address || !*address || strlen(address) >= sizeof(addr.sun_path))
+        return false;
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, address);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return false;
+    if(connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+       0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // NUL-terminated fields: working directory, number of arguments,
+    // arguments, environment
+    std::vector<char> cwd(4096);
+    while(!getcwd(cwd.data(), cwd.size()) && errno == ERANGE)
+        cwd.resize(2 * cwd.size());
+    size_t   nargs   = 0;
+    string_t payload = string_t(cwd.data()) + '\0';
+    string_t fields;
+    for(char** itr = args; *itr; ++itr, ++nargs)
+        fields += string_t(*itr) + '\0';
+    payload += std::to_string(nargs) + '\0' + fields;
+    for(char** itr = environ; itr && *itr; ++itr)
+        payload += string_t(*itr) + '\0';
+    string_t header = std::to_string(payload.size()) + "\n";
+
+    // the stdout and stderr of the launcher go along with the header
+    int           fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+    char          control[CMSG_SPACE(sizeof(fds))];
+    struct iovec  iov;
+    struct msghdr msg;
+    memset(control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base       = const_cast<char*>(header.data());
+    iov.iov_len        = header.size();
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level     = SOL_SOCKET;
+    cmsg->cmsg_type      = SCM_RIGHTS;
+    cmsg->cmsg_len       = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    std::cout.flush();
+    std::cerr.flush();
+    ssize_t sent = 0;
+    while((sent = sendmsg(fd, &msg, 0)) < 0 && errno == EINTR)
+        ;
+    if(sent != static_cast<ssize_t>(header.size()) ||
+       !send_all(fd, payload.data(), payload.size()))
+    {
+        std::cerr << launcher_name << ": cannot send the test to the pool"
+                  << std::endl;
+        close(fd);
+        status = W_EXITCODE(EXIT_FAILURE, 0);
+        return true;
+    }
+
+    string_t reply;
+    char     buffer[64];
+    ssize_t  n = 0;
+    while((n = recv(fd, buffer, sizeof(buffer), 0)) != 0)
+    {
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            break;
+        reply.append(buffer, n);
+    }
+    close(fd);
+
+    int value = 0;
+    if(sscanf(reply.c_str(), "exit %d", &value) == 1)
+        status = W_EXITCODE(value & 0xff, 0);
+    else if(sscanf(reply.c_str(), "signal %d", &value) == 1)
+        status = W_EXITCODE(0, value);
+    else
+    {
+        std::cerr << launcher_name << ": no reply from the pool" << std::endl;
+        status = W_EXITCODE(EXIT_FAILURE, 0);
+    }
+    return true;
+}
+
+#endif
+
+//============================================================================//
+// metrics extracted from the output of the command
+
+struct metric_rule_t
+{
+    string_t   name;
+    string_t   path;  // JSON path, empty for a regular expression
+    std::regex regex;
+};
+
+typedef std::vector<metric_rule_t>   metric_rule_list_t;
+typedef std::map<string_t, string_t> metric_map_t;
+
+// longest line of output the rules are applied to, the rest of a longer line
+// is passed through without being kept
+const size_t max_metric_line = 1 << 20;
+
+// "<name>=<regex>" or "<name>=json:<path>"
+bool
+parse_metric(const string_t& str, metric_rule_list_t& rules)
+{
+    auto pos = str.find('=');
+    if(pos == string_t::npos || pos == 0 || pos + 1 == str.size())
+        return false;
+
+    metric_rule_t _rule;
+    string_t      _expr = str.substr(pos + 1);
+    _rule.name          = str.substr(0, pos);
+    if(_expr.compare(0, 5, "json:") == 0)
+    {
+        _rule.path = _expr.substr(5);
+        if(_rule.path.empty())
+            return false;
+    }
+    else
+    {
+        try
+        {
+            _rule.regex = std::regex(_expr);
+        } catch(const std::regex_error&)
+        {
+            return false;
+        }
+    }
+    rules.push_back(_rule);
+    return true;
+}
+
+//----------------------------------------------------------------------------//
+// JSON values are only skipped or read as scalars: enough to follow a path of
+// keys and array indices ("results[0].time") through one line of output
+
+void
+json_skip_space(const string_t& s, size_t& i)
+{
+    while(i < s.size() && isspace(static_cast<unsigned char>(s[i])))
+        ++i;
+}
+
+// the string at s[i], \u escapes are kept as they are
+bool
+json_string(const string_t& s, size_t& i, string_t* value)
+{
+    if(i >= s.size() || s[i] != '"')
+        return false;
+    for(++i; i < s.size(); ++i)
+    {
+        char c = s[i];
+        if(c == '"')
+        {
+            ++i;
+            return true;
+        }
+        if(c == '\\' && ++i < s.size())
+        {
+            switch((c = s[i]))
+            {
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case 'u':
+                    if(value)
+                        value->push_back('\\');
+                    break;
+                default: break;
+            }
+        }
+        if(value)
+            value->push_back(c);
+    }
+    return false;
+}
+
+bool
+json_skip(const string_t& s, size_t& i)
+{
+    json_skip_space(s, i);
+    if(i >= s.size())
+        return false;
+    if(s[i] == '"')
+        return json_string(s, i, nullptr);
+    if(s[i] == '{' || s[i] == '[')
+    {
+        int depth = 0;
+        while(i < s.size())
+        {
+            char c = s[i];
+            if(c == '"')
+            {
+                if(!json_string(s, i, nullptr))
+                    return false;
+                continue;
+            }
+            ++i;
+            if(c == '{' || c == '[')
+                ++depth;
+            else if((c == '}' || c == ']') && --depth == 0)
+                return true;
+        }
+        return false;
+    }
+    // a number or a literal
+    size_t beg = i;
+    while(i < s.size() && s[i] != '\0' && !strchr(",:{}[] \t\r\n", s[i]))
+        ++i;
+    return i > beg;
+}
+
+// the scalar at "path" in the JSON document "s" (strings without the quotes)
+bool
+json_find(const string_t& s, const string_t& path, string_t& value)
+{
+    size_t i = 0;
+    size_t p = 0;
+    while(p < path.size())
+    {
+        json_skip_space(s, i);
+        if(i >= s.size())
+            return false;
+        if(path[p] == '.')
+        {
+            ++p;
+            continue;
+        }
+        if(path[p] == '[')
+        {
+            auto end = path.find(']', p);
+            if(end == string_t::npos || s[i] != '[')
+                return false;
+            auto n = std::strtoul(path.c_str() + p + 1, nullptr, 10);
+            p      = end + 1;
+            ++i;
+            for(unsigned long k = 0; k < n; ++k)
+            {
+                if(!json_skip(s, i))
+                    return false;
+                json_skip_space(s, i);
+                if(i >= s.size() || s[i] != ',')
+                    return false;
+                ++i;
+            }
+            continue;
+        }
+
+        auto     end = path.find_first_of(".[", p);
+        string_t key = path.substr(p, end - p);
+        p            = (end == string_t::npos) ? path.size() : end;
+        if(s[i] != '{')
+            return false;
+        ++i;
+        while(true)
+        {
+            string_t _key;
+            json_skip_space(s, i);
+            if(!json_string(s, i, &_key))
+                return false;
+            json_skip_space(s, i);
+            if(i >= s.size() || s[i] != ':')
+                return false;
+            ++i;
+            if(_key == key)
+                break;
+            if(!json_skip(s, i))
+                return false;
+            json_skip_space(s, i);
+            if(i >= s.size() || s[i] != ',')
+                return false;
+            ++i;
+        }
+    }
+
+    json_skip_space(s, i);
+    if(i >= s.size() || s[i] == '{' || s[i] == '[')
+        return false;
+    value.clear();
+    if(s[i] == '"')
+        return json_string(s, i, &value);
+    size_t beg = i;
+    if(!json_skip(s, i))
+        return false;
+    value = s.substr(beg, i - beg);
+    return value != "null";
+}
+
+//----------------------------------------------------------------------------//
+// apply the rules to a line of output, the last match of a rule wins
+
+void
+scan_metrics(const metric_rule_list_t& rules, const string_t& line,
+             metric_map_t& values)
+{
+    auto        _first = line.find_first_not_of(" \t");
+    bool        _json  = (_first != string_t::npos &&
+                    (line[_first] == '{' || line[_first] == '['));
+    string_t    _value;
+    std::smatch _match;
+    for(const auto& itr : rules)
+    {
+        if(!itr.path.empty())
+        {
+            if(_json && json_find(line, itr.path, _value))
+                values[itr.name] = _value;
+        }
+        else if(std::regex_search(line, _match, itr.regex))
+            values[itr.name] = _match[(_match.size() > 1) ? 1 : 0].str();
+    }
+}
+
+// a decimal number, as reported by numeric/double measurements
+bool
+is_number(const string_t& str)
+{
+    if(str.empty() || !strchr("+-.0123456789", str[0]))
+        return false;
+    char*  end = nullptr;
+    double val = std::strtod(str.c_str(), &end);
+    return end == str.c_str() + str.size() && std::isfinite(val);
+}
+
+string_t
+xml_escape(const string_t& str)
+{
+    string_t _escaped;
+    for(auto c : str)
+    {
+        switch(c)
+        {
+            case '&': _escaped += "&amp;"; break;
+            case '<': _escaped += "&lt;"; break;
+            case '>': _escaped += "&gt;"; break;
+            case '"': _escaped += "&quot;"; break;
+            default: _escaped += c; break;
+        }
+    }
+    return _escaped;
+}
+
+const string_t&
+metrics_header()
+{
+    static string_t _instance = "# pyctest-metrics 1";
+    return _instance;
+}
+
+// report the values as measurements (numbers as numeric/double, anything else
+// as text/string) and append the numbers to the time series in "store":
+//
+//      # pyctest-metrics 1
+//      <seconds since the epoch>\t<test>\t<metric>\t<value>
+//
+bool
+report_metrics(const metric_map_t& values, const string_t& store,
+               const string_t& name)
+{
+    for(const auto& itr : values)
+    {
+        bool _number = is_number(itr.second);
+        std::cout << "<DartMeasurement name=\"" << xml_escape(itr.first)
+                  << "\" type=\""
+                  << ((_number) ? "numeric/double" : "text/string") << "\">"
+                  << xml_escape(itr.second) << "</DartMeasurement>\n";
+    }
+    std::cout.flush();
+
+    if(store.empty() || values.empty())
+        return true;
+
+    // tests reporting to the same store can run at the same time
+    baseline_lock _lock(store);
+    bool          _new = !std::ifstream(store.c_str()).good();
+    std::ofstream ofs(store.c_str(), std::ios_base::app);
+    if(!ofs)
+        return false;
+    if(_new)
+        ofs << metrics_header() << '\n';
+    auto _now = std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+    for(const auto& itr : values)
+        if(is_number(itr.second))
+            ofs << _now << '\t' << name << '\t' << itr.first << '\t'
+                << itr.second << '\n';
+    return ofs.good();
+}
+
+//----------------------------------------------------------------------------//
+// run the command and give each line of its output (stdout and stderr) to
+// "scan" after passing it on to stdout
+
+typedef std::function<void(const string_t&)> line_func_t;
+
+#if defined(_WIN32)
+
+// no pipe: the output is passed on once the command finished
+status_t
+run_scanned(char** args, double& wall, void*, const line_func_t& scan)
+{
+    const char* tmp    = getenv("TEMP");
+    string_t    output = string_t((tmp && *tmp) ? tmp : ".") +
+                      "/pyctest-metrics-" + std::to_string(_getpid()) +
+                      ".log";
+    status_t status = run_command(args, {}, wall, nullptr, output.c_str());
+
+    std::ifstream ifs(output.c_str(), std::ios_base::binary);
+    string_t      line;
+    while(std::getline(ifs, line))
+    {
+        std::cout << line << '\n';
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.size() > max_metric_line)
+            line.resize(max_metric_line);
+        scan(line);
+    }
+    ifs.close();
+    std::cout.flush();
+    std::remove(output.c_str());
+    return status;
+}
+
+#else
+
+// the output is passed on as it arrives and only the current line is kept.
+// A child that stays in the background keeps the pipe (and the launcher)
+// open until it exits
+status_t
+run_scanned(char** args, double& wall, struct rusage* usage,
+            const line_func_t& scan)
+{
+    int fds[2];
+    if(pipe(fds) != 0)
+    {
+        perror("pipe");
+        return W_EXITCODE(EXIT_FAILURE, 0);
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    auto beg  = clock_type::now();
+    child_pid = fork();
+    if(child_pid < 0)
+    {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return W_EXITCODE(EXIT_FAILURE, 0);
+    }
+
+    if(child_pid == 0)
+    {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[1]);
+        execvp(args[0], args);
+        std::cerr << launcher_name << ": cannot execute \"" << args[0]
+                  << "\": " << strerror(errno) << std::endl;
+        _exit(127);
+    }
+    close(fds[1]);
+
+    string_t line;
+    char     buffer[65536];
+    ssize_t  n = 0;
+    while((n = read(fds[0], buffer, sizeof(buffer))) != 0)
+    {
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            break;
+        std::cout.write(buffer, n);
+        std::cout.flush();
+        for(ssize_t i = 0; i < n; ++i)
+        {
+            if(buffer[i] != '\n')
+            {
+                if(line.size() < max_metric_line)
+                    line.push_back(buffer[i]);
+                continue;
+            }
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            scan(line);
+            line.clear();
+        }
+    }
+    if(!line.empty())
+        scan(line);
+    close(fds[0]);
+
+    int status = 0;
+    while(wait4(child_pid, &status, 0, usage) < 0)
+    {
+        if(errno != EINTR)
+        {
+            perror("wait4");
+            return W_EXITCODE(EXIT_FAILURE, 0);
+        }
+    }
+    wall      = seconds_type(clock_type::now() - beg).count();
+    child_pid = 0;
+    return status;
+}
+
+#endif
+
+//============================================================================//
+// measure the resources of one run of the command and extract the metrics of
+// the rules from its output
+
+int
+measure(char** args, const options_t& opts)
+{
+    metric_rule_list_t _rules;
+    for(const auto& itr : opts.metrics)
+    {
+        if(!parse_metric(itr, _rules))
+        {
+            std::cerr << launcher_name << ": invalid metric rule \"" << itr
+                      << "\"" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    metric_map_t _metrics;
+    auto         _scan = [&](const string_t& line) {
+        scan_metrics(_rules, line, _metrics);
+    };
+    // the key of the test in the store
+    string_t _name = opts.name;
+    for(char** itr = args; _name.empty() && *itr; ++itr)
+        _name += string_t((itr != args) ? " " : "") + *itr;
+
+#if defined(_WIN32)
+    // no rusage on Windows, run the command without measurements
+    double   wall   = 0.0;
+    status_t status = (_rules.empty())
+                          ? run_command(args, {}, wall, nullptr)
+                          : run_scanned(args, wall, nullptr, _scan);
+    if(!_rules.empty())
+    {
+        std::cout << '\n';
+        if(!report_metrics(_metrics, opts.metric_store, _name))
+            std::cerr << launcher_name << ": cannot write \""
+                      << opts.metric_store << "\"" << std::endl;
+    }
+    return exit_code(status);
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = forward_signal;
+    sigemptyset(&action.sa_mask);
+    for(int sig : { SIGINT, SIGTERM, SIGHUP, SIGQUIT })
+        sigaction(sig, &action, nullptr);
+
+    double        wall = 0.0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    status_t status = (_rules.empty())
+                          ? run_command(args, {}, wall, &usage)
+                          : run_scanned(args, wall, &usage, _scan);
+
+#    if defined(__APPLE__)
+    double rss_mib = static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+#    else
+    double rss_mib = static_cast<double>(usage.ru_maxrss) / 1024.0;
+#    endif
+    double utime = to_seconds(usage.ru_utime);
+    double stime = to_seconds(usage.ru_stime);
+
+    // make sure the measurements start on a new line
+    std::cout << '\n';
+    if(!opts.no_resources)
+    {
+        measurement("CPU Time", utime + stime);
+        measurement("User Time", utime);
+        measurement("System Time", stime);
+        measurement("Peak RSS", rss_mib);
+        measurement("Read Bytes", 512.0 * usage.ru_inblock, 15);
+        measurement("Write Bytes", 512.0 * usage.ru_oublock, 15);
+    }
+    if(!report_metrics(_metrics, opts.metric_store, _name))
+        std::cerr << launcher_name << ": cannot write \"" << opts.metric_store
+                  << "\"" << std::endl;
+    std::cout.flush();
+
+    return exit_code(status);
+#endif
+}
+
+//============================================================================//
+// batches of test cases
+
+// exit code of a skipped case (SKIP_RETURN_CODE of the tests of the cases)
+const int skip_return_code = 77;
+
+struct case_result_t
+{
+    case_result_t()
+    : time(0.0)
+    {
+    }
+
+    string_t status;  // "passed", "failed", or "skipped"
+    double   time;
+    string_t output;
+};
+
+typedef std::map<string_t, case_result_t> result_map_t;
+
+std::vector<char*>
+to_argv(std::vector<string_t>& args)
+{
+    std::vector<char*> argv;
+    for(auto& itr : args)
+        argv.push_back(&itr[0]);
+    argv.push_back(nullptr);
+    return argv;
+}
+
+string_t
+read_file(const string_t& fname)
+{
+    std::ifstream     ifs(fname.c_str(), std::ios_base::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+//----------------------------------------------------------------------------//
+// results file of a batch, and of the executables of the "pyctest" protocol:
+//
+//      # pyctest-batch-results 1
+//      <status>\t<seconds>\t<size of the output>\t<case>\n<output>\n
+//
+// with one entry per case and <status> "passed", "failed", or "skipped"
+
+const string_t&
+results_header()
+{
+    static string_t _instance = "# pyctest-batch-results 1";
+    return _instance;
+}
+
+bool
+read_results(const string_t& fname, result_map_t& results)
+{
+    std::ifstream ifs(fname.c_str(), std::ios_base::binary);
+    string_t      line;
+    if(!ifs || !std::getline(ifs, line) || line != results_header())
+        return false;
+
+    while(std::getline(ifs, line))
+    {
+        std::stringstream ss(line);
+        case_result_t     result;
+        size_t            size = 0;
+        string_t          name;
+        if(!std::getline(ss, result.status, '\t') || !(ss >> result.time) ||
+           !(ss >> size) || ss.get() != '\t' || !std::getline(ss, name))
+            return false;
+        result.output.resize(size);
+        if(size > 0 && !ifs.read(&result.output[0], size))
+            return false;
+        ifs.ignore(1);
+        results[name] = result;
+    }
+    return true;
+}
+
+bool
+write_results(const string_t& fname, const result_map_t& results)
+{
+    string_t      tmp = fname + ".tmp";
+    std::ofstream ofs(tmp.c_str(), std::ios_base::binary);
+    if(!ofs)
+        return false;
+    ofs << results_header() << '\n';
+    for(const auto& itr : results)
+        ofs << itr.second.status << '\t' << std::setprecision(9)
+            << itr.second.time << '\t' << itr.second.output.size() << '\t'
+            << itr.first << '\n'
+            << itr.second.output << '\n';
+    ofs.close();
+    return ofs && std::rename(tmp.c_str(), fname.c_str()) == 0;
+}
+
+//----------------------------------------------------------------------------//
+// JUnit XML reports of GoogleTest (--gtest_output=xml) and Catch2 (-r junit)
+
+// text of XML content: the tags are dropped and the entities and CDATA
+// sections decoded
+string_t
+xml_text(const string_t& xml)
+{
+    static const std::pair<string_t, char> entities[] = {
+        { "&lt;", '<' },   { "&gt;", '>' },   { "&amp;", '&' },
+        { "&quot;", '"' }, { "&apos;", '\'' }
+    };
+
+    string_t text;
+    for(size_t i = 0; i < xml.size();)
+    {
+        if(xml.compare(i, 9, "<![CDATA[") == 0)
+        {
+            size_t end = std::min(xml.find("]]>", i + 9), xml.size());
+            text += xml.substr(i + 9, end - i - 9);
+            i = end + 3;
+        }
+        else if(xml[i] == '<')
+        {
+            i = std::min(xml.find('>', i), xml.size()) + 1;
+        }
+        else if(xml.compare(i, 2, "&#") == 0 &&
+                xml.find(';', i) != string_t::npos)
+        {
+            size_t end = xml.find(';', i);
+            long   c   = (xml[i + 2] == 'x')
+                          ? std::strtol(xml.c_str() + i + 3, nullptr, 16)
+                          : std::strtol(xml.c_str() + i + 2, nullptr, 10);
+            if(c > 0 && c < 128)
+                text += static_cast<char>(c);
+            i = end + 1;
+        }
+        else
+        {
+            bool entity = false;
+            for(const auto& itr : entities)
+            {
+                if(xml.compare(i, itr.first.length(), itr.first) == 0)
+                {
+                    text += itr.second;
+                    i += itr.first.length();
+                    entity = true;
+                    break;
+                }
+            }
+            if(!entity)
+                text += xml[i++];
+        }
+    }
+    return text;
+}
+
+string_t
+xml_attribute(const string_t& tag, const string_t& name)
+{
+    string_t key = " " + name + "=\"";
+    size_t   beg = tag.find(key);
+    if(beg == string_t::npos)
+        return "";
+    beg += key.length();
+    return xml_text(tag.substr(beg, tag.find('"', beg) - beg));
+}
+
+// results by "Suite.Case" (GoogleTest) or test case name (Catch2)
+result_map_t
+read_junit(const string_t& fname, bool gtest)
+{
+    string_t     xml = read_file(fname);
+    result_map_t results;
+    for(size_t pos = xml.find("<testcase"); pos != string_t::npos;
+        pos        = xml.find("<testcase", pos))
+    {
+        size_t end = xml.find('>', pos);
+        if(end == string_t::npos)
+            break;
+        string_t tag = xml.substr(pos, end - pos);
+        string_t body;
+        pos = end + 1;
+        if(tag.back() != '/')
+        {
+            size_t close = std::min(xml.find("</testcase>", pos), xml.size());
+            body         = xml.substr(pos, close - pos);
+            pos          = close;
+        }
+
+        string_t name = xml_attribute(tag, "name");
+        if(gtest)
+            name = xml_attribute(tag, "classname") + "." + name;
+
+        bool failed = body.find("<failure") != string_t::npos ||
+                      body.find("<error") != string_t::npos;
+        bool skipped = body.find("<skipped") != string_t::npos ||
+                       xml_attribute(tag, "status") == "notrun" ||
+                       xml_attribute(tag, "result") == "skipped";
+
+        string_t text  = xml_text(body);
+        size_t   first = text.find_first_not_of(" \t\r\n");
+        size_t   last  = text.find_last_not_of(" \t\r\n");
+        if(first != string_t::npos)
+            text = text.substr(first, last + 1 - first) + '\n';
+        else
+            text.clear();
+
+        case_result_t& result = results[name];
+        result.time += std::atof(xml_attribute(tag, "time").c_str());
+        result.output += text;
+        if(failed)
+            result.status = "failed";
+        else if(result.status.empty())
+            result.status = (skipped) ? "skipped" : "passed";
+    }
+    return results;
+}
+
+//----------------------------------------------------------------------------//
+// name of a case (the last argument of the command of its test) in the
+// results of the protocol
+string_t
+case_name(const string_t& protocol, const string_t& arg)
+{
+    if(protocol == "gtest")
+    {
+        const string_t flag = "--gtest_filter=";
+        return (arg.compare(0, flag.length(), flag) == 0)
+                   ? arg.substr(flag.length())
+                   : arg;
+    }
+    if(protocol == "catch2")
+    {
+        string_t name;
+        for(size_t i = 0; i < arg.size(); ++i)
+            name += (arg[i] == '\\' && i + 1 < arg.size()) ? arg[++i] : arg[i];
+        return name;
+    }
+    return arg;
+}
+
+// the entry of the case or, e.g. for the sections of a Catch2 test case, the
+// entries named "<case>/..." combined
+bool
+find_case(const result_map_t& reported, const string_t& name,
+          case_result_t& result)
+{
+    auto itr = reported.find(name);
+    if(itr != reported.end())
+    {
+        result = itr->second;
+        return true;
+    }
+
+    bool found = false;
+    for(itr = reported.lower_bound(name + "/");
+        itr != reported.end() && itr->first.compare(0, name.length() + 1,
+                                                    name + "/") == 0;
+        ++itr)
+    {
+        result.time += itr->second.time;
+        result.output += itr->second.output;
+        if(!found || itr->second.status == "failed")
+            result.status = itr->second.status;
+        found = true;
+    }
+    return found;
+}
+
+//----------------------------------------------------------------------------//
+// run the cases of a batch with one process and write their results. The
+// launcher only fails if the results cannot be written: the tests of the
+// cases (which require the batch as a fixture) report the failures
+
+int
+batch(char** args, int nargs, const options_t& opts)
+{
+    bool gtest = (opts.batch == "gtest");
+    if(!gtest && opts.batch != "catch2" && opts.batch != "pyctest")
+    {
+        std::cerr << launcher_name << ": unknown batch protocol \""
+                  << opts.batch << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(opts.results.empty() || opts.cases == 0 ||
+       opts.cases >= static_cast<unsigned>(nargs))
+    {
+        std::cerr << launcher_name << ": --batch requires --results and "
+                  << "--cases <N> with N less than the number of arguments"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#if !defined(_WIN32)
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = forward_signal;
+    sigemptyset(&action.sa_mask);
+    for(int sig : { SIGINT, SIGTERM, SIGHUP, SIGQUIT })
+        sigaction(sig, &action, nullptr);
+#endif
+
+    std::vector<string_t> command(args, args + nargs - opts.cases);
+    std::vector<string_t> cases(args + nargs - opts.cases, args + nargs);
+
+    string_t report =
+        opts.results + ((opts.batch == "pyctest") ? ".report" : ".xml");
+    std::remove(report.c_str());
+
+    std::vector<string_t> cmd = command;
+    if(opts.batch == "pyctest")
+    {
+        cmd.insert(cmd.end(), cases.begin(), cases.end());
+        set_environment("PYCTEST_BATCH_RESULTS", report);
+    }
+    else
+    {
+        string_t filter;
+        for(const auto& itr : cases)
+            filter += ((filter.empty()) ? "" : ((gtest) ? ":" : ",")) +
+                      ((gtest) ? case_name(opts.batch, itr) : itr);
+        if(gtest)
+        {
+            cmd.push_back("--gtest_filter=" + filter);
+            cmd.push_back("--gtest_output=xml:" + report);
+        }
+        else
+        {
+            cmd.insert(cmd.end(), { filter, "-r", "junit", "-o", report });
+        }
+    }
+
+    double   wall   = 0.0;
+    status_t status = run_command(to_argv(cmd).data(), {}, wall, nullptr);
+
+    result_map_t reported;
+    if(opts.batch == "pyctest")
+        read_results(report, reported);
+    else
+        reported = read_junit(report, gtest);
+    std::remove(report.c_str());
+
+    // keyed by the case argument
+    result_map_t          results;
+    std::vector<string_t> missing;
+    for(const auto& itr : cases)
+    {
+        case_result_t result;
+        if(find_case(reported, case_name(opts.batch, itr), result))
+            results[itr] = result;
+        else
+            missing.push_back(itr);
+    }
+
+    // e.g. the process crashed: isolate the case responsible
+    if(!missing.empty())
+    {
+        std::cout << launcher_name << ": " << missing.size() << " of "
+                  << cases.size() << " cases have no result (batch "
+                  << describe_status(status) << "), running them one at a time"
+                  << std::endl;
+        string_t output = opts.results + ".out";
+        for(const auto& itr : missing)
+        {
+            std::vector<string_t> single = command;
+            single.push_back(itr);
+            case_result_t result;
+            status_t      _status = run_command(to_argv(single).data(), {},
+                                           result.time, nullptr,
+                                           output.c_str());
+            result.status = (succeeded(_status)) ? "passed" : "failed";
+            result.output = read_file(output);
+            if(!succeeded(_status))
+                result.output += string_t(launcher_name) + ": " +
+                                 describe_status(_status) + "\n";
+            results[itr] = result;
+        }
+        std::remove(output.c_str());
+        std::remove(report.c_str());
+    }
+
+    std::map<string_t, int> counts;
+    for(const auto& itr : results)
+        ++counts[itr.second.status];
+    std::cout << '\n'
+              << launcher_name << ": " << counts["passed"] << " passed, "
+              << counts["failed"] << " failed, " << counts["skipped"]
+              << " skipped" << std::endl;
+
+    if(!write_results(opts.results, results))
+    {
+        std::cerr << launcher_name << ": cannot write \"" << opts.results
+                  << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// report the result of a case of a batch as the result of this test
+int
+batch_result(const string_t& fname, const string_t& name)
+{
+    result_map_t results;
+    if(!read_results(fname, results))
+    {
+        std::cerr << launcher_name << ": cannot read the results of the batch "
+                  << "\"" << fname << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto itr = results.find(name);
+    if(itr == results.end())
+    {
+        std::cerr << launcher_name << ": no result for \"" << name << "\" in \""
+                  << fname << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const case_result_t& result = itr->second;
+    std::cout << result.output;
+    if(!result.output.empty() && result.output.back() != '\n')
+        std::cout << '\n';
+    measurement("Batched Time", result.time);
+    std::cout.flush();
+
+    if(result.status == "skipped")
+        return skip_return_code;
+    return (result.status == "passed") ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//============================================================================//
+// run a pyctest.pool command in the worker pool, or directly without a pool
+
+int
+pool(char** args)
+{
+    status_t status = 0;
+    if(pool_request(args, status))
+        return exit_code(status);
+
+#if defined(_WIN32)
+    double wall = 0.0;
+    return exit_code(run_command(args, {}, wall, nullptr));
+#else
+    execvp(args[0], args);
+    std::cerr << launcher_name << ": cannot execute \"" << args[0]
+              << "\": " << strerror(errno) << std::endl;
+    return 127;
+#endif
+}
+
+//============================================================================//
+// run the command as a benchmark and compare the median with the baseline
+
+int
+benchmark(char** args, const options_t& opts)
+{
+#if !defined(_WIN32)
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = forward_signal;
+    sigemptyset(&action.sa_mask);
+    for(int sig : { SIGINT, SIGTERM, SIGHUP, SIGQUIT })
+        sigaction(sig, &action, nullptr);
+    struct rusage  _usage;
+    struct rusage* usage = &_usage;
+#else
+    void* usage = nullptr;
+#endif
+
+    std::vector<double> times;
+    for(unsigned i = 0; i < opts.warmup + opts.repeat; ++i)
+    {
+        double   wall   = 0.0;
+        status_t status = run_command(args, opts.cpus, wall, usage);
+        if(!succeeded(status))
+        {
+            std::cerr << launcher_name << ": run " << (i + 1)
+                      << " of the benchmark failed" << std::endl;
+            return exit_code(status);
+        }
+        if(i >= opts.warmup)
+            times.push_back(wall);
+    }
+
+    double              med = median(times);
+    std::vector<double> deviations;
+    for(auto itr : times)
+        deviations.push_back(std::fabs(itr - med));
+    double mad = median(deviations);
+
+    std::cout << '\n';
+    measurement("Median Time", med);
+    measurement("MAD Time", mad);
+    measurement("Min Time", *std::min_element(times.begin(), times.end()));
+    measurement("Repetitions", times.size());
+
+    if(opts.baseline.empty())
+        return EXIT_SUCCESS;
+
+    baseline_lock lock(opts.baseline);
+    baseline_t    baseline;
+    read_baseline(opts.baseline, baseline);
+
+    int  ret = EXIT_SUCCESS;
+    auto itr = baseline.find(opts.name);
+    if(itr != baseline.end() && itr->second.first > 0.0)
+    {
+        double base   = itr->second.first;
+        double change = med / base - 1.0;
+        // 1.4826 * MAD estimates the standard deviation of normal noise
+        double noise = 3.0 * 1.4826 * std::max(mad, itr->second.second);
+        measurement("Baseline Median Time", base);
+        measurement("Relative Change", change);
+        if(change > opts.threshold && med - base > noise)
+        {
+            std::cout << launcher_name << ": \"" << opts.name
+                      << "\" regressed: median " << med << " s vs. baseline "
+                      << base << " s (" << std::setprecision(3)
+                      << 100.0 * change << "% > " << 100.0 * opts.threshold
+                      << "%)" << std::endl;
+            if(!opts.update_baseline)
+                ret = EXIT_FAILURE;
+        }
+    }
+
+    if(opts.update_baseline)
+    {
+        baseline[opts.name] = std::make_pair(med, mad);
+        if(!write_baseline(opts.baseline, baseline))
+        {
+            std::cerr << launcher_name << ": cannot write \"" << opts.baseline
+                      << "\"" << std::endl;
+            ret = EXIT_FAILURE;
+        }
+    }
+    std::cout.flush();
+    return ret;
+}
+
+//============================================================================//
+// run the command many times at once and stop at the first failure
+
+string_t
+stress_log(unsigned iteration)
+{
+#if defined(_WIN32)
+    const char* tmp = getenv("TEMP");
+    int         pid = _getpid();
+#else
+    const char* tmp = getenv("TMPDIR");
+    int         pid = getpid();
+#endif
+    return string_t((tmp && *tmp) ? tmp : ".") + "/pyctest-stress-" +
+           std::to_string(pid) + "-" + std::to_string(iteration) + ".log";
+}
+
+#if !defined(_WIN32)
+
+// process groups of the runs, 0 = free slot. Written before the signal
+// handler can see them, so a signal from CTest reaches every run
+std::vector<pid_t>    stress_pids;
+volatile sig_atomic_t stress_interrupted = 0;
+
+extern "C" void
+forward_stress_signal(int sig)
+{
+    stress_interrupted = 1;
+    for(auto pid : stress_pids)
+        if(pid > 0)
+            kill(-pid, sig);
+}
+
+#endif
+
+int
+stress(char** args, const options_t& opts)
+{
+    uint64_t seed = opts.seed;
+    if(!opts.has_seed)
+        seed = (static_cast<uint64_t>(std::random_device{}()) << 32) ^
+               std::random_device{}();
+    std::mt19937_64                        rng(seed);
+    std::uniform_real_distribution<double> delay(0.0, opts.jitter);
+
+    unsigned finished = 0;
+    unsigned failures = 0;
+    unsigned failed   = 0;  // first failing run
+    status_t status   = 0;
+    string_t output;
+
+    // the result of a run, returns false once no more runs should start
+    auto finish = [&](unsigned i, status_t _status) {
+        string_t _log = stress_log(i);
+        ++finished;
+        if(!succeeded(_status) && failures++ == 0)
+        {
+            failed = i;
+            status = _status;
+            output = read_file(_log);
+        }
+        std::remove(_log.c_str());
+        return failures == 0 || opts.keep_going;
+    };
+
+#if defined(_WIN32)
+    // one run at a time without process groups to kill on Windows
+    for(unsigned i = 0; i < opts.stress; ++i)
+    {
+        set_environment("PYCTEST_STRESS_ITERATION", std::to_string(i));
+        set_environment("PYCTEST_STRESS_SEED", std::to_string(seed + i));
+        if(opts.jitter > 0.0)
+            std::this_thread::sleep_for(
+                std::chrono::duration<double, std::milli>(delay(rng)));
+        double   wall = 0.0;
+        string_t log  = stress_log(i);
+        if(!finish(i, run_command(args, opts.cpus, wall, nullptr,
+                                  log.c_str())))
+            break;
+    }
+    unsigned jobs = 1;
+#else
+    long     ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned jobs = (opts.jobs > 0) ? opts.jobs
+                                    : static_cast<unsigned>(std::max(ncpu, 1L));
+    jobs          = std::max(std::min(jobs, opts.stress), 1U);
+    stress_pids.assign(jobs, 0);
+    std::vector<unsigned> iterations(jobs, 0);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = forward_stress_signal;
+    sigemptyset(&action.sa_mask);
+    for(int sig : { SIGINT, SIGTERM, SIGHUP, SIGQUIT })
+        sigaction(sig, &action, nullptr);
+
+    std::cout.flush();
+    std::cerr.flush();
+
+    unsigned started = 0;
+    unsigned running = 0;
+    bool     stop    = false;
+    while(true)
+    {
+        for(size_t slot = 0; slot < jobs && !stop && !stress_interrupted &&
+                             started < opts.stress;
+            ++slot)
+        {
+            if(stress_pids[slot] > 0)
+                continue;
+            unsigned i     = started++;
+            double   _wait = (opts.jitter > 0.0) ? delay(rng) : 0.0;
+            string_t _log  = stress_log(i);
+            pid_t    pid   = fork();
+            if(pid < 0)
+            {
+                perror("fork");
+                stop = true;
+                break;
+            }
+            if(pid == 0)
+            {
+                // its own process group so a failure can stop the whole run
+                setpgid(0, 0);
+                int fd = open(_log.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+                if(fd >= 0)
+                {
+                    dup2(fd, STDOUT_FILENO);
+                    dup2(fd, STDERR_FILENO);
+                    close(fd);
+                }
+                setenv("PYCTEST_STRESS_ITERATION", std::to_string(i).c_str(),
+                       1);
+                setenv("PYCTEST_STRESS_SEED", std::to_string(seed + i).c_str(),
+                       1);
+                if(_wait > 0.0)
+                    usleep(static_cast<useconds_t>(1000.0 * _wait));
+                execvp(args[0], args);
+                std::cerr << launcher_name << ": cannot execute \"" << args[0]
+                          << "\": " << strerror(errno) << std::endl;
+                _exit(127);
+            }
+            setpgid(pid, pid);
+            stress_pids[slot] = pid;
+            iterations[slot]  = i;
+            ++running;
+        }
+
+        if(running == 0)
+            break;
+
+        int   _status = 0;
+        pid_t pid     = waitpid(-1, &_status, 0);
+        if(pid < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            perror("waitpid");
+            break;
+        }
+
+        auto slot = std::find(stress_pids.begin(), stress_pids.end(), pid) -
+                    stress_pids.begin();
+        if(slot == static_cast<long>(jobs))
+            continue;
+        stress_pids[slot] = 0;
+        --running;
+
+        // the runs killed after a failure or by a signal are not counted
+        if(stop || stress_interrupted)
+        {
+            std::remove(stress_log(iterations[slot]).c_str());
+            continue;
+        }
+        if(!finish(iterations[slot], _status))
+        {
+            stop = true;
+            for(auto itr : stress_pids)
+                if(itr > 0)
+                    kill(-itr, SIGKILL);
+        }
+    }
+#endif
+
+    double rate = (finished > 0) ? static_cast<double>(failures) / finished
+                                 : 0.0;
+    std::cout << '\n'
+              << launcher_name << ": " << finished << " runs (" << jobs
+              << " at a time, seed " << seed << "), " << failures
+              << " failed";
+#if !defined(_WIN32)
+    if(stress_interrupted)
+        std::cout << " (interrupted)";
+#endif
+    if(failures == 0 && finished > 0)
+        // "rule of three": 95% upper bound of the rate with no failure
+        std::cout << ", failure rate < " << std::setprecision(3)
+                  << 3.0 / finished << " (95% confidence)";
+    else if(finished > 0)
+        std::cout << ", failure rate " << std::setprecision(3) << rate;
+    std::cout << '\n';
+    measurement("Stress Runs", finished);
+    measurement("Stress Failures", failures);
+    measurement("Failure Rate", rate);
+
+    if(failures > 0)
+    {
+        std::cout << launcher_name << ": run " << failed
+                  << " (PYCTEST_STRESS_ITERATION=" << failed
+                  << " PYCTEST_STRESS_SEED=" << seed + failed
+                  << ") failed with " << describe_status(status) << ":\n"
+                  << output;
+        if(!output.empty() && output.back() != '\n')
+            std::cout << '\n';
+    }
+    std::cout.flush();
+    return (failures > 0 || finished < opts.stress) ? EXIT_FAILURE
+                                                    : EXIT_SUCCESS;
+}
+
+//============================================================================//
+// run a libFuzzer target for a slice of time and merge the inputs it found
+// into its corpus. The corpus directories are flat
+
+#if defined(_WIN32)
+
+bool
+make_directory(const string_t& dir)
+{
+    return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+}
+
+std::vector<string_t>
+list_directory(const string_t& dir)
+{
+    std::vector<string_t> files;
+    struct _finddata_t    data;
+    intptr_t              handle = _findfirst((dir + "/*").c_str(), &data);
+    if(handle == -1)
+        return files;
+    do
+    {
+        if(!(data.attrib & _A_SUBDIR))
+            files.push_back(data.name);
+    } while(_findnext(handle, &data) == 0);
+    _findclose(handle);
+    return files;
+}
+
+void
+remove_directory(const string_t& dir)
+{
+    for(const auto& itr : list_directory(dir))
+        std::remove((dir + "/" + itr).c_str());
+    _rmdir(dir.c_str());
+}
+
+#else
+
+bool
+make_directory(const string_t& dir)
+{
+    return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+std::vector<string_t>
+list_directory(const string_t& dir)
+{
+    std::vector<string_t> files;
+    DIR*                  handle = opendir(dir.c_str());
+    if(!handle)
+        return files;
+    while(struct dirent* entry = readdir(handle))
+    {
+        struct stat info;
+        string_t    path = dir + "/" + entry->d_name;
+        if(stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            files.push_back(entry->d_name);
+    }
+    closedir(handle);
+    return files;
+}
+
+void
+remove_directory(const string_t& dir)
+{
+    for(const auto& itr : list_directory(dir))
+        unlink((dir + "/" + itr).c_str());
+    rmdir(dir.c_str());
+}
+
+#endif
+
+// create "dir" and its missing parents
+bool
+make_directories(const string_t& dir)
+{
+    for(auto pos = dir.find_first_of("/\\", 1); pos != string_t::npos;
+        pos      = dir.find_first_of("/\\", pos + 1))
+        make_directory(dir.substr(0, pos));
+    return make_directory(dir);
+}
+
+int
+fuzz(char** args, int nargs, const options_t& opts)
+{
+    if(opts.fuzz_time <= 0.0)
+    {
+        std::cerr << launcher_name << ": --fuzz requires --fuzz-time <s>"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#if !defined(_WIN32)
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = forward_signal;
+    sigemptyset(&action.sa_mask);
+    for(int sig : { SIGINT, SIGTERM, SIGHUP, SIGQUIT })
+        sigaction(sig, &action, nullptr);
+#endif
+
+#if defined(_WIN32)
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+    // the corpus can be shared by builds running at the same time: it is
+    // locked while the crashes are replayed and while it is replaced by the
+    // merged corpus, but not while fuzzing, so every run collects its new
+    // inputs in a directory of its own
+    string_t corpus    = opts.fuzz;
+    string_t found     = corpus + ".new-" + std::to_string(pid);
+    string_t merged    = corpus + ".merge";
+    string_t artifacts = corpus + ".artifacts";
+    if(!make_directories(corpus) || !make_directory(artifacts))
+    {
+        std::cerr << launcher_name << ": cannot create the corpus \"" << corpus
+                  << "\": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    make_directory(found);
+
+    std::vector<string_t> command(args, args + nargs);
+    std::vector<string_t> crashes;
+    string_t              log    = merged + ".log";
+    double                wall   = 0.0;
+    status_t              status = 0;
+
+    auto report = [&](size_t added) {
+        std::cout << '\n'
+                  << launcher_name << ": " << added
+                  << " new inputs, corpus of " << list_directory(corpus).size()
+                  << " inputs in \"" << corpus << "\"\n";
+        for(const auto& itr : crashes)
+        {
+            std::cout << launcher_name << ": " << itr
+                      << ", reproduce with:\n   ";
+            for(const auto& arg : command)
+                std::cout << " " << arg;
+            std::cout << " " << artifacts << "/" << itr << '\n';
+        }
+        measurement("Corpus Size", list_directory(corpus).size());
+        measurement("New Inputs", added);
+        measurement("Crashes", crashes.size());
+        std::cout.flush();
+        return exit_code(status);
+    };
+
+    // replay the crashes of the previous runs: the fixed ones join the
+    // corpus, the others fail the test again without fuzzing (a new slice
+    // would rarely find them again and the test would look flaky)
+    std::unique_ptr<baseline_lock> lock(new baseline_lock(corpus));
+    for(const auto& itr : list_directory(artifacts))
+    {
+        std::vector<string_t> replay = command;
+        replay.push_back(artifacts + "/" + itr);
+        status_t _status = run_command(to_argv(replay).data(), {}, wall,
+                                       nullptr, log.c_str());
+        if(succeeded(_status))
+        {
+            std::rename((artifacts + "/" + itr).c_str(),
+                        (corpus + "/" + itr).c_str());
+            continue;
+        }
+        std::cout << launcher_name << ": " << itr << " still fails ("
+                  << describe_status(_status) << "):\n"
+                  << read_file(log);
+        crashes.push_back(itr);
+        status = _status;
+    }
+    std::remove(log.c_str());
+    if(!crashes.empty())
+    {
+        remove_directory(found);
+        return report(0);
+    }
+    lock.reset();
+
+    // the first corpus directory receives the new inputs
+    std::vector<string_t> cmd = command;
+    cmd.push_back("-max_total_time=" +
+                  std::to_string(static_cast<long>(std::ceil(opts.fuzz_time))));
+    cmd.push_back("-artifact_prefix=" + artifacts + "/");
+    cmd.push_back("-print_final_stats=1");
+    cmd.insert(cmd.end(), { found, corpus });
+    cmd.insert(cmd.end(), opts.fuzz_seeds.begin(), opts.fuzz_seeds.end());
+
+    status     = run_command(to_argv(cmd).data(), {}, wall, nullptr);
+    auto added = list_directory(found).size();
+
+    // keep the inputs of the corpus and the new ones that add coverage
+    lock.reset(new baseline_lock(corpus));
+    // left over by an interrupted run
+    remove_directory(merged);
+    std::vector<string_t> merge = command;
+    merge.push_back("-merge=1");
+    merge.push_back("-artifact_prefix=" + artifacts + "/");
+    merge.insert(merge.end(), { merged, corpus, found });
+
+    string_t old       = corpus + ".old";
+    bool     minimized = make_directory(merged) &&
+                     succeeded(run_command(to_argv(merge).data(), {}, wall,
+                                           nullptr, log.c_str())) &&
+                     std::rename(corpus.c_str(), old.c_str()) == 0;
+    if(minimized)
+    {
+        std::rename(merged.c_str(), corpus.c_str());
+        remove_directory(old);
+    }
+    else
+    {
+        // do not lose the new inputs: add them to the corpus as they are
+        std::cout << launcher_name << ": the corpus could not be minimized:\n"
+                  << read_file(log);
+        for(const auto& itr : list_directory(found))
+            std::rename((found + "/" + itr).c_str(),
+                        (corpus + "/" + itr).c_str());
+        remove_directory(merged);
+    }
+    std::remove(log.c_str());
+    remove_directory(found);
+
+    crashes = list_directory(artifacts);
+    return report(added);
+}
+
+}  // namespace
+
+//============================================================================//
+
+int
+main(int argc, char** argv)
+{
+    options_t opts;
+    int       first = 1;
+    for(; first < argc; ++first)
+    {
+        string_t arg = argv[first];
+        if(arg == "--")
+        {
+            ++first;
+            break;
+        }
+        if(arg.compare(0, 2, "--") != 0)
+            break;
+
+        if(arg == "--update-baseline")
+        {
+            opts.update_baseline = true;
+            continue;
+        }
+        if(arg == "--pool")
+        {
+            opts.pool = true;
+            continue;
+        }
+        if(arg == "--keep-going")
+        {
+            opts.keep_going = true;
+            continue;
+        }
+        if(arg == "--no-resources")
+        {
+            opts.no_resources = true;
+            continue;
+        }
+
+        if(first + 1 >= argc)
+        {
+            std::cerr << launcher_name << ": missing value of " << arg
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+        string_t val = argv[++first];
+        if(arg == "--batch")
+            opts.batch = val;
+        else if(arg == "--results")
+            opts.results = val;
+        else if(arg == "--cases")
+            opts.cases = std::strtoul(val.c_str(), nullptr, 10);
+        else if(arg == "--batch-result")
+            opts.batch_result = val;
+        else if(arg == "--repeat")
+            opts.repeat = std::strtoul(val.c_str(), nullptr, 10);
+        else if(arg == "--stress")
+            opts.stress = std::strtoul(val.c_str(), nullptr, 10);
+        else if(arg == "--jobs")
+            opts.jobs = std::strtoul(val.c_str(), nullptr, 10);
+        else if(arg == "--seed")
+        {
+            opts.seed     = std::strtoull(val.c_str(), nullptr, 10);
+            opts.has_seed = true;
+        }
+        else if(arg == "--jitter")
+            opts.jitter = std::atof(val.c_str());
+        else if(arg == "--fuzz")
+            opts.fuzz = val;
+        else if(arg == "--fuzz-time")
+            opts.fuzz_time = std::atof(val.c_str());
+        else if(arg == "--fuzz-seed")
+            opts.fuzz_seeds.push_back(val);
+        else if(arg == "--metric")
+            opts.metrics.push_back(val);
+        else if(arg == "--metric-store")
+            opts.metric_store = val;
+        else if(arg == "--warmup")
+            opts.warmup = std::strtoul(val.c_str(), nullptr, 10);
+        else if(arg == "--threshold")
+            opts.threshold = std::atof(val.c_str());
+        else if(arg == "--baseline")
+            opts.baseline = val;
+        else if(arg == "--name")
+            opts.name = val;
+        else if(arg == "--cpus")
+        {
+            if(!parse_cpus(val, opts.cpus))
+            {
+                std::cerr << launcher_name << ": invalid CPU list \"" << val
+                          << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            std::cerr << launcher_name << ": unknown option " << arg
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(first >= argc)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [<options>] [--] <command> [<arg>...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<char*> args(argv + first, argv + argc);
+    args.push_back(nullptr);
+
+    if(!opts.batch_result.empty())
+    {
+        if(argc - first != 1)
+        {
+            std::cerr << launcher_name << ": --batch-result requires one case"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+        return batch_result(opts.batch_result, argv[first]);
+    }
+
+    if(!opts.batch.empty())
+        return batch(argv + first, argc - first, opts);
+
+    if(opts.pool)
+        return pool(args.data());
+
+    if(opts.stress > 0)
+        return stress(args.data(), opts);
+
+    if(!opts.fuzz.empty())
+        return fuzz(argv + first, argc - first, opts);
+
+    if(opts.repeat == 0)
+        return measure(args.data(), opts);
+
+    if(opts.name.empty())
+    {
+        for(int i = first; i < argc; ++i)
+            opts.name += string_t((i > first) ? " " : "") + argv[i];
+    }
+    return benchmark(args.data(), opts);
+}
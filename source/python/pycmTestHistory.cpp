@@ -0,0 +1,462 @@
+// MIT License
+//
+// Copyright (c) 2018, The Regents of the University of California,
+// through Lawrence Berkeley National Laboratory (subject to receipt of any
+// required approvals from the U.S. Dept. of Energy).  All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pycmTestHistory.hpp"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "cmCryptoHash.h"
+#include "cmSystemTools.h"
+#include "cmsys/Directory.hxx"
+
+//============================================================================//
+
+namespace pyct
+{
+//============================================================================//
+
+const pycmTestHistory::string_t&
+pycmTestHistory::Header()
+{
+    static string_t _instance = "# pyctest-history 1";
+    return _instance;
+}
+
+//============================================================================//
+
+bool
+pycmTestHistory::Load(const string_t& fname)
+{
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    string_t line;
+    std::getline(ifs, line);
+    ifs.close();
+
+    if(line.compare(0, Header().length(), Header()) == 0)
+        return Read(fname);
+    return ReadCostData(fname);
+}
+
+//============================================================================//
+
+bool
+pycmTestHistory::ReadCostData(const string_t& fname)
+{
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    // the failed tests listed after "---" only refer to the last run
+    for(auto& itr : m_records)
+        itr.second.failed = false;
+
+    string_t line;
+    bool     failed = false;
+    while(std::getline(ifs, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.empty())
+            continue;
+        if(line == "---")
+        {
+            failed = true;
+            continue;
+        }
+
+        if(failed)
+        {
+            auto itr = m_records.find(line);
+            if(itr != m_records.end())
+                itr->second.failed = true;
+            continue;
+        }
+
+        // "<name> <runs> <cost>" -- test names may contain spaces so the
+        // numbers are taken from the end of the line
+        auto cpos = line.find_last_of(' ');
+        if(cpos == string_t::npos || cpos == 0)
+            continue;
+        auto rpos = line.find_last_of(' ', cpos - 1);
+        if(rpos == string_t::npos || rpos == 0)
+            continue;
+
+        record_t& rec = m_records[line.substr(0, rpos)];
+        rec.count     = std::strtoull(line.c_str() + rpos + 1, nullptr, 10);
+        rec.cost      = std::atof(line.c_str() + cpos + 1);
+    }
+    return true;
+}
+
+//============================================================================//
+
+bool
+pycmTestHistory::Read(const string_t& fname)
+{
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    string_t line;
+    while(std::getline(ifs, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        auto tab = line.find('\t');
+        if(tab == string_t::npos || tab == 0)
+            continue;
+
+        record_t&         rec = m_records[line.substr(0, tab)];
+        std::stringstream ss(line.substr(tab + 1));
+        string_t          entry;
+        while(ss >> entry)
+        {
+            auto eq = entry.find('=');
+            if(eq == string_t::npos)
+                continue;
+            string_t key = entry.substr(0, eq);
+            string_t val = entry.substr(eq + 1);
+            if(key == "count")
+                rec.count = std::strtoull(val.c_str(), nullptr, 10);
+            else if(key == "cost")
+                rec.cost = std::atof(val.c_str());
+            else if(key == "cpu")
+                rec.cpu = std::atof(val.c_str());
+            else if(key == "memory")
+                rec.memory = std::atof(val.c_str());
+            else if(key == "failed")
+                rec.failed = (val == "1");
+            else if(key == "inputs")
+                rec.inputs = val;
+            else if(key == "runs")
+                rec.runs = std::strtoull(val.c_str(), nullptr, 10);
+            else if(key == "passes")
+                rec.passes = std::strtoull(val.c_str(), nullptr, 10);
+            else if(key == "flaky")
+                rec.flaky = std::strtoull(val.c_str(), nullptr, 10);
+            else if(key == "streak")
+                rec.streak = std::strtoull(val.c_str(), nullptr, 10);
+            else if(key == "times")
+            {
+                rec.times.clear();
+                std::stringstream vs(val);
+                string_t          item;
+                while(std::getline(vs, item, ','))
+                    rec.AddTime(std::atof(item.c_str()));
+            }
+        }
+    }
+    return true;
+}
+
+//============================================================================//
+
+bool
+pycmTestHistory::Write(const string_t& fname) const
+{
+    std::ofstream ofs(fname.c_str());
+    if(!ofs)
+        return false;
+
+    ofs << Header() << '\n';
+    for(const auto& itr : m_records)
+    {
+        const record_t& rec = itr.second;
+        ofs << itr.first << '\t' << "count=" << rec.count
+            << " cost=" << std::setprecision(6) << rec.cost;
+        if(rec.cpu > 0.0)
+            ofs << " cpu=" << rec.cpu;
+        if(rec.memory > 0.0)
+            ofs << " memory=" << rec.memory;
+        if(rec.failed)
+            ofs << " failed=1";
+        if(!rec.inputs.empty())
+            ofs << " inputs=" << rec.inputs;
+        if(rec.runs > 0)
+            ofs << " runs=" << rec.runs << " passes=" << rec.passes
+                << " streak=" << rec.streak;
+        if(rec.flaky > 0)
+            ofs << " flaky=" << rec.flaky;
+        for(size_t i = 0; i < rec.times.size(); ++i)
+            ofs << ((i == 0) ? " times=" : ",") << rec.times[i];
+        ofs << '\n';
+    }
+    return static_cast<bool>(ofs);
+}
+
+//============================================================================//
+
+void
+pycmTestHistory::AddResults(const result_map_t& results)
+{
+    for(const auto& itr : results)
+    {
+        record_t& rec = m_records[itr.first];
+        rec.runs += 1;
+        if(itr.second)
+        {
+            rec.passes += 1;
+            rec.streak += 1;
+        }
+        else
+            rec.streak = 0;
+    }
+}
+
+//============================================================================//
+
+bool
+pycmTestHistory::ReadReruns(const string_t& fname)
+{
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    string_t line;
+    while(std::getline(ifs, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        // "<name>\t<passes>\t<runs>", the name may contain tabs
+        auto rpos = line.find_last_of('\t');
+        if(rpos == string_t::npos || rpos == 0)
+            continue;
+        auto ppos = line.find_last_of('\t', rpos - 1);
+        if(ppos == string_t::npos || ppos == 0)
+            continue;
+
+        uint64_t  passes = std::strtoull(line.c_str() + ppos + 1, nullptr, 10);
+        uint64_t  runs   = std::strtoull(line.c_str() + rpos + 1, nullptr, 10);
+        record_t& rec    = m_records[line.substr(0, ppos)];
+        rec.runs += runs;
+        rec.passes += std::min(passes, runs);
+        if(passes > 0)
+            rec.flaky += 1;
+    }
+    return true;
+}
+
+//============================================================================//
+//
+//  every test in LastTest.log looks like:
+//
+//      1/3 Test: <name>
+//      ...
+//      <DartMeasurement name="<name>" type="numeric/double">1</DartMeasurement>
+//      ...
+//      Test time =   0.01 sec
+//      ----------------------------------------------------------
+//      Test Passed.                (or "Test Failed.", etc.)
+//      "<name>" end time: ...
+//
+
+bool
+pycmTestHistory::ReadTestLog(const string_t& fname, result_map_t& results,
+                             measurement_map_t* measurements,
+                             time_map_t*        times)
+{
+    static const string_t measurement_tag = "<DartMeasurement name=\"";
+
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    string_t line;
+    string_t name;
+    while(std::getline(ifs, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        auto pos = line.find(" Test: ");
+        if(pos != string_t::npos && line.find('/') < pos &&
+           isdigit(static_cast<int>(line[0])))
+        {
+            name = line.substr(pos + 7);
+            continue;
+        }
+
+        pos = line.find(measurement_tag);
+        if(measurements && !name.empty() && pos != string_t::npos)
+        {
+            // <DartMeasurement name="..." type="numeric/...">value</...>
+            auto nbeg = pos + measurement_tag.length();
+            auto nend = line.find('"', nbeg);
+            auto vbeg = line.find('>', nbeg);
+            if(nend != string_t::npos && vbeg != string_t::npos &&
+               line.find("type=\"numeric/", nend) < vbeg)
+                (*measurements)[name][line.substr(nbeg, nend - nbeg)] =
+                    std::atof(line.c_str() + vbeg + 1);
+            continue;
+        }
+
+        if(name.empty() || line.compare(0, 5, "Test ") != 0)
+            continue;
+        if(line == "Test Passed.")
+            results[name] = true;
+        else if(line.compare(0, 10, "Test time ") != 0)
+            results[name] = false;
+        else
+        {
+            // "Test time =   1.23 sec"
+            auto tpos = line.find('=');
+            if(times && tpos != string_t::npos)
+                (*times)[name] = std::atof(line.c_str() + tpos + 1);
+            continue;
+        }
+        name.clear();
+    }
+    return true;
+}
+
+//============================================================================//
+
+pycmTestHistory::string_t
+pycmTestHistory::FindTestLog(const string_t& dir)
+{
+    cmsys::Directory directory;
+    if(!directory.Load(dir))
+        return "";
+
+    string_t newest;
+    for(unsigned long i = 0; i < directory.GetNumberOfFiles(); ++i)
+    {
+        string_t file = directory.GetFile(i);
+        if(file.compare(0, 8, "LastTest") != 0 ||
+           file.compare(0, 15, "LastTestsFailed") == 0 || file.length() < 4 ||
+           file.compare(file.length() - 4, 4, ".log") != 0)
+            continue;
+
+        file    = dir + "/" + file;
+        int cmp = 0;
+        if(newest.empty() ||
+           (cmSystemTools::FileTimeCompare(file, newest, &cmp) && cmp > 0))
+            newest = file;
+    }
+    return newest;
+}
+
+//============================================================================//
+
+const pycmFileHashCache::string_t&
+pycmFileHashCache::Header()
+{
+    static string_t _instance = "# pyctest-file-hashes 1";
+    return _instance;
+}
+
+//============================================================================//
+
+bool
+pycmFileHashCache::Read(const string_t& fname)
+{
+    std::ifstream ifs(fname.c_str());
+    if(!ifs)
+        return false;
+
+    string_t line;
+    std::getline(ifs, line);
+    if(line != Header())
+        return false;
+
+    while(std::getline(ifs, line))
+    {
+        std::stringstream ss(line);
+        entry_t           entry;
+        string_t          path;
+        if(!(ss >> entry.size >> entry.mtime >> entry.recorded >> entry.hash))
+            continue;
+        ss.get();
+        if(std::getline(ss, path) && !path.empty())
+            m_entries[path] = entry;
+    }
+    return true;
+}
+
+//============================================================================//
+
+bool
+pycmFileHashCache::Write(const string_t& fname) const
+{
+    std::ofstream ofs(fname.c_str());
+    if(!ofs)
+        return false;
+
+    ofs << Header() << '\n';
+    for(const auto& itr : m_entries)
+        ofs << itr.second.size << '\t' << itr.second.mtime << '\t'
+            << itr.second.recorded << '\t' << itr.second.hash << '\t'
+            << itr.first << '\n';
+    return static_cast<bool>(ofs);
+}
+
+//============================================================================//
+
+pycmFileHashCache::string_t
+pycmFileHashCache::Hash(const string_t& path)
+{
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+    {
+        m_entries.erase(path);
+        return "";
+    }
+
+    entry_t& entry = m_entries[path];
+    uint64_t size  = static_cast<uint64_t>(info.st_size);
+    int64_t  mtime = static_cast<int64_t>(info.st_mtime);
+    if(!entry.hash.empty() && entry.size == size && entry.mtime == mtime &&
+       entry.mtime < entry.recorded)
+        return entry.hash;
+
+    entry.size     = size;
+    entry.mtime    = mtime;
+    entry.recorded = static_cast<int64_t>(std::time(nullptr));
+    entry.hash     = cmCryptoHash(cmCryptoHash::AlgoSHA1).HashFile(path);
+    return entry.hash;
+}
+
+//============================================================================//
+
+}  // namespace pyct
+
+//============================================================================//
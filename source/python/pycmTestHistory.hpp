@@ -0,0 +1,226 @@
+// MIT License
+//
+// Copyright (c) 2018, The Regents of the University of California,
+// through Lawrence Berkeley National Laboratory (subject to receipt of any
+// required approvals from the U.S. Dept. of Energy).  All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef pycmTestHistory_hpp_
+#define pycmTestHistory_hpp_
+
+#include "cmConfigure.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+//============================================================================//
+
+namespace pyct
+{
+//
+// Per-test timing history used to derive scheduling properties (COST,
+// PROCESSORS) when the CTestTestfile.cmake is generated.
+//
+// Two formats are read:
+//
+//  - CTestCostData.txt (written by CTest in Testing/Temporary):
+//
+//      <name> <runs> <average seconds>
+//      ...
+//      ---
+//      <name of test that failed in the last run>
+//      ...
+//
+//  - the pyctest history (written by pycmTestHistory::Write):
+//
+//      # pyctest-history 1
+//      <name>\t<key>=<value> <key>=<value>...
+//
+//    Unknown keys are ignored so the history can be extended without
+//    invalidating older files. The times of the recent runs are a
+//    comma-separated list (times=<seconds>,<seconds>...)
+//
+// The results of a run are read from the LastTest.log of CTest and the
+// re-runs of the failed tests (see RERUN_FAILED_TESTS in Init.cmake) from
+// PyCTestReruns.txt:
+//
+//      <name>\t<passed re-runs>\t<re-runs>
+//
+// A test that failed and then passed when it was re-run is counted as flaky.
+// It stays "known flaky" until it has passed FlakyStreak() runs in a row
+//
+
+//============================================================================//
+
+class pycmTestHistory
+{
+public:
+    typedef std::string           string_t;
+    typedef std::vector<string_t> strvec_t;
+    typedef std::vector<double>   dblvec_t;
+
+    struct record_t
+    {
+        record_t()
+        : count(0)
+        , cost(0.0)
+        , cpu(0.0)
+        , memory(0.0)
+        , failed(false)
+        , runs(0)
+        , passes(0)
+        , flaky(0)
+        , streak(0)
+        {
+        }
+
+        double PassRate() const
+        {
+            return (runs > 0) ? static_cast<double>(passes) / runs : 1.0;
+        }
+        bool IsFlaky() const { return flaky > 0 && streak < FlakyStreak(); }
+        // keep the last RecentRuns() times
+        void AddTime(double val)
+        {
+            times.push_back(val);
+            if(times.size() > RecentRuns())
+                times.erase(times.begin(), times.end() - RecentRuns());
+        }
+
+        uint64_t count;   // number of runs the averages are taken over
+        double   cost;    // average wall-clock time (seconds)
+        double   cpu;     // average user + system time (seconds), 0 = unknown
+        double   memory;  // recent peak RSS (MiB), 0 = unknown
+        bool     failed;  // failed in the last run
+        string_t inputs;  // hash of the inputs of the last passing run
+        uint64_t runs;    // number of recorded results (including re-runs)
+        uint64_t passes;  // number of passing results
+        uint64_t flaky;   // number of runs rescued by a re-run
+        uint64_t streak;  // consecutive passing runs
+        dblvec_t times;   // recent wall-clock times (seconds), oldest first
+    };
+
+    typedef std::map<string_t, record_t> record_map_t;
+    // test name -> passed
+    typedef std::map<string_t, bool> result_map_t;
+    // test name -> numeric <DartMeasurement> values (e.g. of pyctest-launcher)
+    typedef std::map<string_t, std::map<string_t, double>> measurement_map_t;
+    // test name -> wall-clock time of the run (seconds)
+    typedef std::map<string_t, double> time_map_t;
+
+public:
+    // read either format (detected from the first line) and merge the
+    // records into the history. Returns false if the file cannot be read
+    bool Load(const string_t& fname);
+    bool ReadCostData(const string_t& fname);
+    bool Read(const string_t& fname);
+    bool Write(const string_t& fname) const;
+    // add the results of a run to the pass rates
+    void AddResults(const result_map_t& results);
+    // add the re-runs of the failed tests to the pass rates and count the
+    // tests that passed a re-run as flaky
+    bool ReadReruns(const string_t& fname);
+
+    const record_t* Find(const string_t& name) const
+    {
+        auto itr = m_records.find(name);
+        return (itr != m_records.end()) ? &itr->second : nullptr;
+    }
+    record_t& Get(const string_t& name) { return m_records[name]; }
+
+    void                Clear() { record_map_t().swap(m_records); }
+    size_t              Size() const { return m_records.size(); }
+    bool                Empty() const { return m_records.empty(); }
+    const record_map_t& Records() const { return m_records; }
+
+    static const string_t& Header();
+    static uint64_t        FlakyStreak() { return 25; }
+    static size_t          RecentRuns() { return 20; }
+
+    // results (and optionally the measurements and the times) of the tests
+    // in a LastTest.log. Returns false if the file cannot be read
+    static bool ReadTestLog(const string_t& fname, result_map_t& results,
+                            measurement_map_t* measurements = nullptr,
+                            time_map_t*        times        = nullptr);
+    // newest LastTest*.log in "dir" (e.g. Testing/Temporary) or ""
+    static string_t FindTestLog(const string_t& dir);
+
+private:
+    record_map_t m_records;
+};
+
+//============================================================================//
+// SHA-1 of files, cached by path, size and modification time so unchanged
+// files are not read again. As with the git index, an entry whose
+// modification time is not older than the time it was recorded is "racy"
+// (the file could have changed again within the same second) and the file
+// is hashed again
+//
+//      # pyctest-file-hashes 1
+//      <size>\t<mtime>\t<recorded>\t<hash>\t<path>
+//
+class pycmFileHashCache
+{
+public:
+    typedef std::string string_t;
+
+    struct entry_t
+    {
+        entry_t()
+        : size(0)
+        , mtime(0)
+        , recorded(0)
+        {
+        }
+
+        uint64_t size;
+        int64_t  mtime;
+        int64_t  recorded;
+        string_t hash;
+    };
+
+    typedef std::map<string_t, entry_t> entry_map_t;
+
+public:
+    bool Read(const string_t& fname);
+    bool Write(const string_t& fname) const;
+
+    // hash of the contents of "path" or "" if it is not a readable file
+    string_t Hash(const string_t& path);
+
+    void   Clear() { entry_map_t().swap(m_entries); }
+    size_t Size() const { return m_entries.size(); }
+
+    static const string_t& Header();
+
+private:
+    entry_map_t m_entries;
+};
+
+//============================================================================//
+
+}  // namespace pyct
+
+//============================================================================//
+
+#endif
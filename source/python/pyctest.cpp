@@ -161,6 +161,7 @@ pycmTestGenerator::pycmTestGenerator(pycmTest* test)
 : cmScriptGenerator("CTEST_CONFIGURATION_TYPE", std::vector<string_t>())
 , m_test(test)
 , m_test_generated(false)
+, m_defer_properties(false)
 {
 }
 
@@ -186,6 +187,14 @@ pycmTestGenerator::GetTest() const
 
 //============================================================================//
 
+strvec_t
+pycmTestGenerator::GetCommand() const
+{
+    return (m_command.empty()) ? m_test->GetCommand() : m_command;
+}
+
+//============================================================================//
+
 void
 pycmTestGenerator::GenerateScriptConfigs(std::ostream& os, Indent indent)
 {
@@ -249,7 +258,7 @@ pycmTestGenerator::GenerateOldStyle(std::ostream& fout, Indent indent)
     m_test_generated = true;
 
     // Get the test command line to be executed.
-    std::vector<string_t> const& command = m_test->GetCommand();
+    std::vector<string_t> const command = this->GetCommand();
 
     string_t exe = command[0];
     cmSystemTools::ConvertToUnixSlashes(exe);
@@ -279,20 +288,406 @@ pycmTestGenerator::GenerateOldStyle(std::ostream& fout, Indent indent)
     fout << ")" << std::endl;
 
     // Output properties for the test.
-    cmPropertyMap& pm = m_test->GetProperties();
-    if(!pm.empty())
+    if(!m_defer_properties)
+        this->GenerateProperties(fout, indent);
+}
+
+//============================================================================//
+
+void
+pycmTestGenerator::GenerateProperties(std::ostream& fout, Indent indent)
+{
+    const pycmPropertyList& pm = m_test->GetProperties();
+    if(!pm.empty() || !m_derived.empty())
     {
         fout << indent << "set_tests_properties(" << m_test->GetName()
              << " PROPERTIES ";
         for(auto const& i : pm)
+        {
+            fout << " " << *i.first << " "
+                 << cmOutputConverter::EscapeForCMake(*i.second);
+        }
+        for(auto const& i : m_derived)
         {
             fout << " " << i.first << " "
-                 << cmOutputConverter::EscapeForCMake(i.second.GetValue());
+                 << cmOutputConverter::EscapeForCMake(i.second);
         }
         fout << ")" << std::endl;
     }
 }
 
+//============================================================================//
+
+void
+pycmTestGraph::Build(test_list_t*                test_list,
+                     const test_template_list_t* templates)
+{
+    m_nodes.clear();
+    m_locks.clear();
+    m_cycles.clear();
+    m_missing_fixtures.clear();
+    m_unknown_depends.clear();
+
+    typedef std::map<string_t, index_list_t> fixture_map_t;
+
+    std::map<string_t, size_t> _index;
+    std::vector<strvec_t>      _depends;
+    std::vector<strvec_t>      _locks;
+    fixture_map_t              _setup;
+    fixture_map_t              _required;
+    fixture_map_t              _cleanup;
+    double                     _known  = 0.0;
+    size_t                     _nknown = 0;
+
+    for_each_test(test_list, templates, [&](pycmTest* itr) {
+        size_t      _idx   = m_nodes.size();
+        const char* _procs = itr->GetProperty("PROCESSORS");
+
+        node_t _node;
+        _node.name       = itr->GetName();
+        _node.cost       = estimate_test_cost(itr, 0.0);
+        _node.processors = (_procs) ? std::max(std::atol(_procs), 1L) : 1L;
+        if(_node.cost > 0.0)
+        {
+            _known += _node.cost;
+            ++_nknown;
+        }
+        m_nodes.push_back(_node);
+        _index[_node.name] = _idx;
+
+        _depends.push_back(get_list_property(itr, "DEPENDS"));
+        _locks.push_back(get_list_property(itr, "RESOURCE_LOCK"));
+        for(const auto& fix : get_list_property(itr, "FIXTURES_SETUP"))
+            _setup[fix].push_back(_idx);
+        for(const auto& fix : get_list_property(itr, "FIXTURES_REQUIRED"))
+            _required[fix].push_back(_idx);
+        for(const auto& fix : get_list_property(itr, "FIXTURES_CLEANUP"))
+            _cleanup[fix].push_back(_idx);
+    });
+
+    // same assumption as shard_tests(...) for tests without a known cost
+    double _default = (_nknown > 0) ? (_known / _nknown) : 1.0;
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        if(m_nodes[i].cost <= 0.0)
+            m_nodes[i].cost = _default;
+        for(const auto& lock : _locks[i])
+            m_locks[lock] += m_nodes[i].cost;
+    }
+
+    std::vector<std::set<size_t>> _edges(m_nodes.size());
+    auto add_edges = [&](const index_list_t& _from, const index_list_t& _to) {
+        for(auto i : _from)
+            for(auto j : _to)
+                if(i != j)
+                    _edges[i].insert(j);
+    };
+
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        for(const auto& dep : _depends[i])
+        {
+            auto itr = _index.find(dep);
+            if(itr == _index.end())
+                m_unknown_depends[m_nodes[i].name].push_back(dep);
+            else
+                add_edges({ itr->second }, { i });
+        }
+    }
+
+    for(const auto& itr : _required)
+    {
+        auto _s = _setup.find(itr.first);
+        auto _c = _cleanup.find(itr.first);
+        if(_s == _setup.end() && _c == _cleanup.end())
+        {
+            for(auto i : itr.second)
+                m_missing_fixtures[itr.first].push_back(m_nodes[i].name);
+            continue;
+        }
+        if(_s != _setup.end())
+            add_edges(_s->second, itr.second);
+        if(_c != _cleanup.end())
+            add_edges(itr.second, _c->second);
+    }
+
+    for(const auto& itr : _setup)
+    {
+        auto _c = _cleanup.find(itr.first);
+        if(_c != _cleanup.end())
+            add_edges(itr.second, _c->second);
+    }
+
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        m_nodes[i].edges.assign(_edges[i].begin(), _edges[i].end());
+
+    FindCycles();
+}
+
+//============================================================================//
+// strongly connected components (Kosaraju) without recursion so that long
+// chains of dependencies cannot overflow the stack
+
+void
+pycmTestGraph::FindCycles()
+{
+    typedef std::pair<size_t, size_t> frame_t;
+
+    size_t                    _n = m_nodes.size();
+    index_list_t              _order;
+    std::vector<bool>         _visited(_n, false);
+    std::vector<index_list_t> _reverse(_n);
+
+    _order.reserve(_n);
+    for(size_t i = 0; i < _n; ++i)
+    {
+        for(auto j : m_nodes[i].edges)
+            _reverse[j].push_back(i);
+
+        if(_visited[i])
+            continue;
+        _visited[i] = true;
+        std::vector<frame_t> _stack(1, frame_t(i, 0));
+        while(!_stack.empty())
+        {
+            frame_t&            _top   = _stack.back();
+            const index_list_t& _edges = m_nodes[_top.first].edges;
+            if(_top.second < _edges.size())
+            {
+                size_t _next = _edges[_top.second++];
+                if(!_visited[_next])
+                {
+                    _visited[_next] = true;
+                    _stack.push_back(frame_t(_next, 0));
+                }
+            }
+            else
+            {
+                _order.push_back(_top.first);
+                _stack.pop_back();
+            }
+        }
+    }
+
+    m_in_cycle.assign(_n, false);
+    _visited.assign(_n, false);
+    for(auto ritr = _order.rbegin(); ritr != _order.rend(); ++ritr)
+    {
+        if(_visited[*ritr])
+            continue;
+        _visited[*ritr] = true;
+        index_list_t _component;
+        index_list_t _stack(1, *ritr);
+        while(!_stack.empty())
+        {
+            size_t _cur = _stack.back();
+            _stack.pop_back();
+            _component.push_back(_cur);
+            for(auto j : _reverse[_cur])
+            {
+                if(!_visited[j])
+                {
+                    _visited[j] = true;
+                    _stack.push_back(j);
+                }
+            }
+        }
+
+        if(_component.size() < 2)
+            continue;
+        strvec_t _names;
+        for(auto i : _component)
+        {
+            m_in_cycle[i] = true;
+            _names.push_back(m_nodes[i].name);
+        }
+        std::sort(_names.begin(), _names.end());
+        m_cycles.push_back(_names);
+    }
+}
+
+//============================================================================//
+// longest path through the tests that are not part of a cycle
+
+strvec_t
+pycmTestGraph::CriticalPath(double* length) const
+{
+    const size_t        _npos = std::numeric_limits<size_t>::max();
+    size_t              _n    = m_nodes.size();
+    index_list_t        _indegree(_n, 0);
+    index_list_t        _pred(_n, _npos);
+    std::vector<double> _dist(_n, 0.0);
+    index_list_t        _ready;
+
+    for(size_t i = 0; i < _n; ++i)
+    {
+        _dist[i] = m_nodes[i].cost;
+        if(m_in_cycle[i])
+            continue;
+        for(auto j : m_nodes[i].edges)
+            ++_indegree[j];
+    }
+
+    for(size_t i = 0; i < _n; ++i)
+        if(!m_in_cycle[i] && _indegree[i] == 0)
+            _ready.push_back(i);
+
+    while(!_ready.empty())
+    {
+        size_t i = _ready.back();
+        _ready.pop_back();
+        for(auto j : m_nodes[i].edges)
+        {
+            if(m_in_cycle[j])
+                continue;
+            if(_dist[i] + m_nodes[j].cost > _dist[j])
+            {
+                _dist[j] = _dist[i] + m_nodes[j].cost;
+                _pred[j] = i;
+            }
+            if(--_indegree[j] == 0)
+                _ready.push_back(j);
+        }
+    }
+
+    size_t _last = _npos;
+    for(size_t i = 0; i < _n; ++i)
+        if(!m_in_cycle[i] && (_last == _npos || _dist[i] > _dist[_last]))
+            _last = i;
+
+    strvec_t _path;
+    if(length)
+        *length = (_last == _npos) ? 0.0 : _dist[_last];
+    for(size_t i = _last; i != _npos; i = _pred[i])
+        _path.push_back(m_nodes[i].name);
+    std::reverse(_path.begin(), _path.end());
+    return _path;
+}
+
+//============================================================================//
+
+double
+pycmTestGraph::TotalWork(size_t jobs) const
+{
+    double _work = 0.0;
+    long   _jobs = static_cast<long>(std::min<size_t>(
+        std::max<size_t>(jobs, 1), std::numeric_limits<long>::max()));
+    for(const auto& itr : m_nodes)
+        _work += itr.cost * std::min(itr.processors, _jobs);
+    return _work;
+}
+
+//============================================================================//
+
+double
+pycmTestGraph::MaxLockTime(string_t* lock) const
+{
+    double _max = 0.0;
+    for(const auto& itr : m_locks)
+    {
+        if(itr.second > _max)
+        {
+            _max = itr.second;
+            if(lock)
+                *lock = itr.first;
+        }
+    }
+    return _max;
+}
+
+//============================================================================//
+// no schedule can beat the critical path, the busiest resource lock, or the
+// total work spread evenly over every job
+
+double
+pycmTestGraph::MinWallTime(size_t jobs) const
+{
+    double _path = 0.0;
+    CriticalPath(&_path);
+    jobs = std::max<size_t>(jobs, 1);
+    return std::max(std::max(_path, MaxLockTime()), TotalWork(jobs) / jobs);
+}
+
+//============================================================================//
+
+size_t
+pycmTestGraph::MaxUsefulJobs() const
+{
+    double _path = 0.0;
+    CriticalPath(&_path);
+    double _bound = std::max(_path, MaxLockTime());
+    if(_bound <= 0.0)
+        return 1;
+    double _work = TotalWork(std::numeric_limits<size_t>::max());
+    return std::max<size_t>(static_cast<size_t>(std::ceil(_work / _bound)), 1);
+}
+
+//============================================================================//
+
+size_t
+pycmTestGraph::NumEdges() const
+{
+    size_t _n = 0;
+    for(const auto& itr : m_nodes)
+        _n += itr.edges.size();
+    return _n;
+}
+
+//============================================================================//
+
+void
+pycmTestGraph::Report(std::ostream& os, size_t jobs) const
+{
+    auto join = [](const strvec_t& _names, const string_t& _sep) {
+        std::stringstream ss;
+        for(size_t i = 0; i < _names.size(); ++i)
+            ss << ((i > 0) ? _sep : "") << _names[i];
+        return ss.str();
+    };
+
+    jobs = std::max<size_t>(jobs, 1);
+    os << "Test graph: " << Size() << " tests, " << NumEdges()
+       << " ordering constraints" << std::endl;
+
+    for(const auto& itr : m_cycles)
+        os << "  Error! Dependency cycle between tests: " << join(itr, ", ")
+           << std::endl;
+    for(const auto& itr : m_missing_fixtures)
+        os << "  Warning! Fixture \"" << itr.first
+           << "\" has no setup or cleanup test but is required by: "
+           << join(itr.second, ", ") << std::endl;
+    for(const auto& itr : m_unknown_depends)
+        os << "  Warning! Test \"" << itr.first
+           << "\" depends on unknown tests: " << join(itr.second, ", ")
+           << std::endl;
+
+    double   _path = 0.0;
+    strvec_t _critical = CriticalPath(&_path);
+    string_t _lock;
+    double   _lock_time = MaxLockTime(&_lock);
+    double   _work      = TotalWork(jobs);
+    double   _wall      = MinWallTime(jobs);
+
+    os << "  Total work: " << _work << " seconds" << std::endl;
+    os << "  Critical path: " << _path << " seconds, " << _critical.size()
+       << " tests: " << join(_critical, " -> ") << std::endl;
+    if(_lock_time > 0.0)
+        os << "  Busiest resource lock: \"" << _lock << "\" (" << _lock_time
+           << " seconds)" << std::endl;
+
+    os << "  Minimum wall time with -j" << jobs << ": " << _wall
+       << " seconds (bound by the ";
+    if(_wall == _work / jobs)
+        os << "number of jobs";
+    else if(_wall == _path)
+        os << "critical path";
+    else
+        os << "resource lock \"" << _lock << "\"";
+    os << ")" << std::endl;
+    os << "  More than " << MaxUsefulJobs()
+       << " jobs cannot reduce the wall time" << std::endl;
+}
+
 //============================================================================//
 // this is a test driver program for cmCTest.
 int
@@ -332,6 +727,10 @@ ctest_main_driver(int argc, char const* const* argv)
         return 1;
     }
 
+    // CTest only reads CTestTestfile.cmake so regenerate it from the compact
+    // manifest if only the manifest is present
+    sync_test_manifest();
+
     // If there is a testing input file, check for documentation options
     // only if there are actually arguments.  We want running without
     // arguments to run tests.
@@ -401,11 +800,31 @@ PYBIND11_MODULE(pyctest, ct)
     //
     //------------------------------------------------------------------------//
     // create a new test and add to test list
-    auto test_init = [=](string_t cmdname, py::list cmd, py::dict cmdprops) {
-        auto obj = new pyct::pycmTest();
+    auto test_init = [=](string_t cmdname, py::object cmd, py::dict cmdprops,
+                         string_t profile) {
+        auto obj = pyct::get_test_arena()->Create();
         // set the test name
         if(cmdname.length() > 0)
             obj->SetName(cmdname);
+        // share the default properties of the profile
+        if(!profile.empty())
+            obj->SetProfile(pyct::get_test_arena()->GetProfile(profile));
+        // Python callables and "module:function" (alone or followed by the
+        // arguments) run in the worker pool
+        bool _pool = !py::isinstance<py::list>(cmd);
+        if(!_pool && py::len(cmd) > 0)
+        {
+            py::object _head = cmd[py::int_(0)];
+            if(PyCallable_Check(_head.ptr()))
+                _pool = true;
+            else if(py::isinstance<py::str>(_head) &&
+                    _head.cast<string_t>().find(':') != string_t::npos)
+                _pool = py::module::import("pyctest.pool")
+                            .attr("is_spec")(_head)
+                            .cast<bool>();
+        }
+        if(_pool)
+            cmd = py::module::import("pyctest.pool").attr("command")(cmd);
         // convert the args
         pyct::strvec_t _args;
         for(auto itr : cmd)
@@ -524,6 +943,95 @@ PYBIND11_MODULE(pyctest, ct)
         return test;
     };
     //------------------------------------------------------------------------//
+    auto profile_add = [=](string_t name, py::dict props) {
+        auto profile = pyct::get_test_arena()->GetProfile(name);
+        for(auto itr : props)
+            profile->SetProperty(itr.first.cast<string_t>(),
+                                 itr.second.cast<string_t>().c_str());
+    };
+    //------------------------------------------------------------------------//
+    auto test_template = [=](string_t name_fmt, py::list cmd_fmt,
+                             py::dict props, py::dict params, string_t mode,
+                             string_t profile) {
+        typedef pyct::pycmTestTemplate template_t;
+
+        pyct::strvec_t _cmd;
+        for(auto itr : cmd_fmt)
+            _cmd.push_back(itr.cast<string_t>());
+
+        template_t::strpair_list_t _props;
+        for(auto itr : props)
+            _props.push_back(template_t::strpair_t(
+                itr.first.cast<string_t>(), itr.second.cast<string_t>()));
+
+        // parameter values may be any Python object, use str(...)
+        template_t::param_list_t _params;
+        for(auto itr : params)
+        {
+            pyct::strvec_t _values;
+            for(auto val : itr.second.cast<py::list>())
+                _values.push_back(py::str(val).cast<string_t>());
+            _params.push_back(
+                template_t::param_t(itr.first.cast<string_t>(), _values));
+        }
+
+        template_t::mode_t _mode = template_t::mode_t::PRODUCT;
+        if(upperstr(mode) == "ZIP")
+            _mode = template_t::mode_t::ZIP;
+        else if(upperstr(mode) != "PRODUCT")
+            throw std::runtime_error(
+                "test_template: mode must be \"product\" or \"zip\"");
+
+        auto arena    = pyct::get_test_arena();
+        auto _profile = (profile.empty()) ? nullptr : arena->GetProfile(profile);
+        return arena
+            ->AddTemplate(template_t(name_fmt, _cmd, _props, _params, _mode,
+                                     _profile))
+            ->Size();
+    };
+    //------------------------------------------------------------------------//
+    auto test_discover = [=](py::list executables, string_t framework,
+                             size_t jobs, string_t prefix, py::dict props,
+                             string_t profile, py::list args, size_t batch) {
+        pyct::strvec_t _exes;
+        for(auto itr : executables)
+            _exes.push_back(itr.cast<string_t>());
+        pyct::strvec_t _args;
+        for(auto itr : args)
+            _args.push_back(itr.cast<string_t>());
+        if(jobs == 0)
+            jobs = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        auto     arena = pyct::get_test_arena();
+        py::list tests;
+        for(auto obj : pyct::discover_tests(_exes, framework, jobs, prefix,
+                                            _args, batch))
+        {
+            if(!profile.empty())
+                obj->SetProfile(arena->GetProfile(profile));
+            for(auto itr : props)
+                obj->SetProperty(itr.first.cast<string_t>(),
+                                 itr.second.cast<string_t>().c_str());
+            pyct::get_test_list()->push_back(obj);
+            tests.append(py::cast(new pyct::pycmTestWrapper(obj),
+                                  py::return_value_policy::take_ownership));
+        }
+        return tests;
+    };
+    //------------------------------------------------------------------------//
+    auto test_set_profile = [=](py::object obj, string_t name) {
+        pyobj_cast(_obj, pyct::pycmTestWrapper, obj);
+        auto arena = pyct::get_test_arena();
+        _obj->get()->SetProfile((name.empty()) ? nullptr
+                                               : arena->GetProfile(name));
+    };
+    //------------------------------------------------------------------------//
+    auto test_get_profile = [=](py::object obj) {
+        pyobj_cast(_obj, pyct::pycmTestWrapper, obj);
+        auto profile = _obj->get()->GetProfile();
+        return (profile) ? profile->GetName() : string_t("");
+    };
+    //------------------------------------------------------------------------//
     auto proc_exec = [=](py::object obj, py::list args) {
         pyobj_cast(_obj, pyct::pycmExecuteProcessCommand, obj);
         bool ret = true;
@@ -648,6 +1156,127 @@ PYBIND11_MODULE(pyctest, ct)
         return locals["_ctest_path"].cast<string_t>();
     };
     //------------------------------------------------------------------------//
+    // pyctest-launcher is built and installed next to ctest, in the "bin"
+    // directory of the package
+    auto launcher_path = [=]() {
+        return cmSystemTools::GetFilenamePath(exe_path()) +
+               "/pyctest-launcher";
+    };
+    //------------------------------------------------------------------------//
+    // set the properties of a test of a kind (e.g. "benchmark") whose LABELS
+    // and the LABELS of its profile are added to the label of the kind
+    // instead of replacing it
+    auto set_kind_properties = [](pyct::pycmTest* obj, const string_t& kind,
+                                  py::dict props) {
+        string_t    _labels  = kind;
+        const char* _profile = (obj->GetProfile())
+                                   ? obj->GetProfile()->GetProperty("LABELS")
+                                   : nullptr;
+        if(_profile && *_profile)
+            _labels += ";" + string_t(_profile);
+        obj->SetProperty("LABELS", _labels.c_str());
+        for(auto itr : props)
+        {
+            string_t _key = itr.first.cast<string_t>();
+            string_t _val = itr.second.cast<string_t>();
+            if(_key == "LABELS" && !_val.empty())
+                _val = _labels + ";" + _val;
+            obj->SetProperty(_key, _val.c_str());
+        }
+    };
+    //------------------------------------------------------------------------//
+    // create a test that runs "cmd" as a benchmark through pyctest-launcher
+    auto test_benchmark = [=](string_t name, py::list cmd, size_t repeat,
+                              size_t warmup, string_t cpus, string_t baseline,
+                              double threshold, bool update_baseline,
+                              py::dict props, string_t profile) {
+        if(name.empty() || cmd.size() == 0 || repeat == 0)
+            throw std::runtime_error("benchmark: a name, a command, and at "
+                                     "least one repetition are required");
+
+        sstream_t _threshold;
+        _threshold << threshold;
+        pyct::strvec_t _args = { launcher_path(),
+                                 "--repeat",
+                                 std::to_string(repeat),
+                                 "--warmup",
+                                 std::to_string(warmup),
+                                 "--threshold",
+                                 _threshold.str(),
+                                 "--name",
+                                 name };
+        if(!cpus.empty())
+            _args.insert(_args.end(), { "--cpus", cpus });
+        if(!baseline.empty())
+            _args.insert(_args.end(), { "--baseline",
+                                        cmSystemTools::CollapseFullPath(
+                                            baseline) });
+        if(update_baseline)
+            _args.push_back("--update-baseline");
+        _args.push_back("--");
+        for(auto itr : cmd)
+            _args.push_back(itr.cast<string_t>());
+
+        auto obj = pyct::get_test_arena()->Create(name, _args);
+        if(!profile.empty())
+            obj->SetProfile(pyct::get_test_arena()->GetProfile(profile));
+        // timings of benchmarks running concurrently are not comparable
+        obj->SetProperty("RUN_SERIAL", "ON");
+        set_kind_properties(obj, "benchmark", props);
+        pyct::get_test_list()->push_back(obj);
+        return py::cast(new pyct::pycmTestWrapper(obj),
+                        py::return_value_policy::take_ownership);
+    };
+    //------------------------------------------------------------------------//
+    // create a test that runs the libFuzzer target "cmd" for a slice of time
+    // through pyctest-launcher, which keeps its corpus between runs
+    auto test_fuzz = [=](string_t name, py::list cmd, double seconds,
+                         string_t corpus, py::list seeds, py::dict props,
+                         string_t profile) {
+        if(name.empty() || cmd.size() == 0)
+            throw std::runtime_error("fuzz: a name and a command are required");
+        if(seconds <= 0.0)
+            seconds = ct.attr("FUZZ_TIME").cast<double>();
+        if(corpus.empty())
+        {
+            corpus = ct.attr("FUZZ_CORPUS_DIRECTORY").cast<string_t>();
+            if(corpus.empty())
+                corpus = ct.attr("BINARY_DIRECTORY").cast<string_t>() +
+                         "/fuzz-corpus";
+            string_t _dir = name;
+            for(auto& itr : _dir)
+                if(!isalnum(itr) && itr != '-' && itr != '_' && itr != '.')
+                    itr = '_';
+            corpus += "/" + _dir;
+        }
+
+        sstream_t _seconds;
+        _seconds << seconds;
+        pyct::strvec_t _args = { launcher_path(), "--fuzz",
+                                 cmSystemTools::CollapseFullPath(corpus),
+                                 "--fuzz-time", _seconds.str() };
+        for(auto itr : seeds)
+            _args.insert(_args.end(),
+                         { "--fuzz-seed", cmSystemTools::CollapseFullPath(
+                                              itr.cast<string_t>()) });
+        _args.push_back("--");
+        for(auto itr : cmd)
+            _args.push_back(itr.cast<string_t>());
+
+        auto obj = pyct::get_test_arena()->Create(name, _args);
+        if(!profile.empty())
+            obj->SetProfile(pyct::get_test_arena()->GetProfile(profile));
+        // one core per target so the slice of time is a slice of CPU time,
+        // and time to minimize the corpus
+        obj->SetProperty("PROCESSORS", "1");
+        obj->SetProperty("TIMEOUT",
+                         std::to_string(static_cast<long>(2 * seconds + 60)));
+        set_kind_properties(obj, "fuzz", props);
+        pyct::get_test_list()->push_back(obj);
+        return py::cast(new pyct::pycmTestWrapper(obj),
+                        py::return_value_policy::take_ownership);
+    };
+    //------------------------------------------------------------------------//
     auto str2char_convert = [](const string_t& _str) {
         char* pc = new char[_str.size() + 1];
         std::strcpy(pc, _str.c_str());
@@ -775,10 +1404,266 @@ PYBIND11_MODULE(pyctest, ct)
         copy_cdash(dir);
     };
     //------------------------------------------------------------------------//
-    auto generate_test_file = [=](string_t dir) {
+    // a test of a source of generate_test_file: a dict with "name", "cmd",
+    // and optionally "properties" and "profile", or a (name, cmd) or a
+    // (name, cmd, properties) sequence
+    auto source_test = [=](py::handle item, pyct::pycmTest* test) {
+        py::object _name, _cmd, _props = py::dict(), _profile = py::str("");
+        if(py::isinstance<py::dict>(item))
+        {
+            auto _spec = py::reinterpret_borrow<py::dict>(item);
+            _name      = _spec.attr("get")("name");
+            _cmd       = _spec.attr("get")("cmd");
+            _props     = _spec.attr("get")("properties", _props);
+            _profile   = _spec.attr("get")("profile", _profile);
+        }
+        else
+        {
+            py::tuple _spec(py::reinterpret_borrow<py::object>(item));
+            if(_spec.size() < 2 || _spec.size() > 3)
+                throw std::runtime_error("generate_test_file: a test of the "
+                                         "source is (name, cmd[, "
+                                         "properties])");
+            _name = _spec[0];
+            _cmd  = _spec[1];
+            if(_spec.size() > 2)
+                _props = _spec[2];
+        }
+
+        pyct::strvec_t _args;
+        if(!_cmd.is_none())
+            for(auto itr : _cmd)
+                _args.push_back(itr.cast<string_t>());
+        if(_name.is_none() || _args.empty())
+            throw std::runtime_error("generate_test_file: a test of the source "
+                                     "needs a name and a command");
+
+        test->SetName(_name.cast<string_t>());
+        test->SetCommand(_args);
+        string_t _pname = _profile.cast<string_t>();
+        if(!_pname.empty())
+            test->SetProfile(pyct::get_test_arena()->GetProfile(_pname));
+        for(auto itr : _props.cast<py::dict>())
+            test->SetProperty(itr.first.cast<string_t>(),
+                              itr.second.cast<string_t>().c_str());
+    };
+    //------------------------------------------------------------------------//
+    auto generate_test_file = [=](string_t dir, bool manifest,
+                                  py::object source) {
         if(dir.empty())
             dir = ct.attr("BINARY_DIRECTORY").cast<string_t>();
-        pyct::generate_test_file(dir);
+        pyct::get_flaky_resource_lock() =
+            ct.attr("FLAKY_RESOURCE_LOCK").cast<string_t>();
+        pyct::get_measurement_launcher() =
+            (ct.attr("MEASURE").cast<bool>()) ? launcher_path() : string_t("");
+        pyct::get_memory_budget() = ct.attr("MEMORY_BUDGET").cast<double>();
+        pyct::get_memory_jobs()   = ct.attr("MEMORY_JOBS").cast<long>();
+        // the values extracted by the PYCTEST_METRICS rules of the tests
+        auto&    _metrics = pyct::get_metric_policy();
+        string_t _store   = ct.attr("METRIC_STORE").cast<string_t>();
+        _metrics.launcher = launcher_path();
+        _metrics.store    = (_store.empty())
+                             ? _store
+                             : cmSystemTools::CollapseFullPath(_store);
+        // the derived timeouts do not exceed the default
+        auto& _timeout    = pyct::get_timeout_policy();
+        _timeout.factor   = ct.attr("TIMEOUT_FACTOR").cast<double>();
+        _timeout.quantile = ct.attr("TIMEOUT_QUANTILE").cast<double>();
+        _timeout.floor    = ct.attr("TIMEOUT_FLOOR").cast<double>();
+        _timeout.limit    = std::atof(
+            py::str(ct.attr("TIMEOUT")).cast<string_t>().c_str());
+
+        // the profiler command is a string (split as by a shell) or a list
+        auto&      _profile  = pyct::get_profile_policy();
+        py::object _profiler = ct.attr("PROFILE_COMMAND");
+        _profile.factor      = ct.attr("PROFILE_FACTOR").cast<double>();
+        _profile.floor       = ct.attr("PROFILE_FLOOR").cast<double>();
+        _profile.command     = (py::isinstance<py::str>(_profiler))
+                               ? py::module::import("shlex")
+                                     .attr("split")(_profiler)
+                                     .cast<pyct::strvec_t>()
+                               : _profiler.cast<pyct::strvec_t>();
+        pyct::get_test_batches()->SetLauncher(launcher_path());
+        pyct::get_test_batches()->SetDefaultSize(
+            ct.attr("BATCH_SIZE").cast<size_t>());
+
+        // the tests of the source are converted one at a time as it is
+        // consumed and only the current item is referenced
+        pyct::test_source_t _source;
+        py::iterator        _items;
+        if(!source.is_none())
+        {
+            _items  = py::iter(source);
+            _source = [&](pyct::pycmTest* _test) {
+                if(_items == py::iterator::sentinel())
+                    return false;
+                auto _item = py::reinterpret_borrow<py::object>(*_items);
+                ++_items;
+                source_test(_item, _test);
+                return true;
+            };
+        }
+        pyct::generate_test_file(dir, manifest,
+                                 ct.attr("SHARD_INDEX").cast<size_t>(),
+                                 ct.attr("SHARD_COUNT").cast<size_t>(),
+                                 ct.attr("TIME_BUDGET").cast<double>(),
+                                 ct.attr("TIME_BUDGET_JOBS").cast<size_t>(),
+                                 _source);
+    };
+    //------------------------------------------------------------------------//
+    auto plan_tests = [=](double budget, size_t jobs) {
+        auto     arena = pyct::get_test_arena();
+        auto     plan  = pyct::plan_tests(pyct::get_test_list(),
+                                     &arena->Templates(), budget, jobs, true);
+        py::list names;
+        for(const auto& itr : plan)
+            names.append(itr);
+        return names;
+    };
+    //------------------------------------------------------------------------//
+    auto shard_tests = [=](size_t index, size_t count) {
+        auto     arena = pyct::get_test_arena();
+        auto     shard = pyct::shard_tests(pyct::get_test_list(),
+                                       &arena->Templates(), index, count);
+        py::list names;
+        for(const auto& itr : shard)
+            names.append(itr);
+        return names;
+    };
+    //------------------------------------------------------------------------//
+    auto load_test_manifest = [=](string_t fname) {
+        int ntests = pyct::load_test_manifest(fname, pyct::get_test_list(),
+                                              pyct::get_test_arena());
+        if(ntests < 0)
+        {
+            sstream_t ss;
+            ss << "Error loading test manifest: \"" << fname << "\"";
+            throw std::runtime_error(ss.str().c_str());
+        }
+        return ntests;
+    };
+    //------------------------------------------------------------------------//
+    auto analyze_tests = [=](size_t jobs, bool verbose) {
+        if(jobs == 0)
+            jobs = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        auto                arena = pyct::get_test_arena();
+        pyct::pycmTestGraph graph;
+        graph.Build(pyct::get_test_list(), &arena->Templates());
+        if(verbose)
+            graph.Report(std::cout, jobs);
+
+        double   path     = 0.0;
+        auto     critical = graph.CriticalPath(&path);
+        py::dict report;
+        report["cycles"]               = graph.Cycles();
+        report["missing_fixtures"]     = graph.MissingFixtures();
+        report["unknown_dependencies"] = graph.UnknownDepends();
+        report["critical_path"]        = critical;
+        report["critical_path_time"]   = path;
+        report["total_work"]           = graph.TotalWork(jobs);
+        report["min_wall_time"]        = graph.MinWallTime(jobs);
+        report["max_useful_jobs"]      = graph.MaxUsefulJobs();
+        return report;
+    };
+    //------------------------------------------------------------------------//
+    auto compare_trees = [=](string_t baseline_dir, string_t candidate_dir,
+                             string_t regex, string_t label, size_t repeat,
+                             string_t cpus, double confidence, bool verbose) {
+        string_t binary_dir = ct.attr("BINARY_DIRECTORY").cast<string_t>();
+        if(candidate_dir.empty())
+            candidate_dir = binary_dir;
+        if(confidence <= 0.0 || confidence >= 1.0)
+            throw std::runtime_error("confidence must be between 0 and 1");
+
+        auto _filter = pyct::name_label_filter(regex, label);
+
+        auto results = pyct::compare_trees(
+            pyct::get_test_list(), &pyct::get_test_arena()->Templates(),
+            binary_dir, baseline_dir, candidate_dir,
+            std::max<size_t>(repeat, 1), pyct::parse_cpu_list(cpus),
+            confidence, verbose, _filter);
+        if(verbose)
+            pyct::report_comparisons(std::cout, results, confidence);
+
+        py::list _ret;
+        for(const auto& itr : results)
+        {
+            py::dict _cmp;
+            _cmp["name"]      = itr.name;
+            _cmp["baseline"]  = itr.baseline;
+            _cmp["candidate"] = itr.candidate;
+            _cmp["speedup"]   = itr.speedup;
+            _cmp["lower"]     = itr.lower;
+            _cmp["upper"]     = itr.upper;
+            _cmp["error"]     = itr.error;
+            _ret.append(_cmp);
+        }
+        return _ret;
+    };
+    //------------------------------------------------------------------------//
+    auto stress_tests = [=](string_t regex, string_t label, size_t count,
+                            size_t jobs, uint64_t seed, double jitter,
+                            bool keep_going) {
+        auto _filter = pyct::name_label_filter(regex, label);
+
+        auto failed = pyct::stress_tests(
+            pyct::get_test_list(), &pyct::get_test_arena()->Templates(),
+            launcher_path(), ct.attr("BINARY_DIRECTORY").cast<string_t>(),
+            std::max<size_t>(count, 1), jobs, seed, jitter, keep_going,
+            _filter);
+
+        py::list _ret;
+        for(const auto& itr : failed)
+            _ret.append(itr);
+        return _ret;
+    };
+    //------------------------------------------------------------------------//
+    auto select_affected = [=](string_t base, string_t head,
+                               string_t source_dir, string_t coverage_map,
+                               bool fallback) {
+        if(source_dir.empty())
+            source_dir = ct.attr("SOURCE_DIRECTORY").cast<string_t>();
+
+        auto           selection = pyct::get_test_selection();
+        pyct::strvec_t files;
+        if(!pyct::git_changed_files(source_dir, base, head, files))
+        {
+            std::cerr << "Warning! Unable to get the files changed since \""
+                      << base << "\" in \"" << source_dir
+                      << "\". Every test will run" << std::endl;
+            selection->Disable();
+            return files;
+        }
+
+        selection->SetSourceDirectory(source_dir);
+        selection->SetFallback(fallback);
+        if(!coverage_map.empty() && !selection->ReadCoverageMap(coverage_map))
+        {
+            sstream_t ss;
+            ss << "Error reading coverage map: \"" << coverage_map << "\"";
+            throw std::runtime_error(ss.str().c_str());
+        }
+        selection->SetChangedFiles(files);
+        return files;
+    };
+    //------------------------------------------------------------------------//
+    auto add_label_sources = [=](string_t label, py::list globs) {
+        pyct::strvec_t _globs;
+        for(auto itr : globs)
+            _globs.push_back(itr.cast<string_t>());
+        pyct::get_test_selection()->AddLabelSources(label, _globs);
+    };
+    //------------------------------------------------------------------------//
+    auto load_test_history = [=](string_t fname) {
+        auto _history = pyct::get_test_history();
+        if(!_history->Load(fname))
+        {
+            sstream_t ss;
+            ss << "Error loading test history: \"" << fname << "\"";
+            throw std::runtime_error(ss.str().c_str());
+        }
+        return _history->Size();
     };
     //------------------------------------------------------------------------//
     auto execute = [=](std::vector<std::string> pargs) {
@@ -803,7 +1688,8 @@ PYBIND11_MODULE(pyctest, ct)
         return pyct::ctest_main_driver(argc, argv);
     };
     //------------------------------------------------------------------------//
-    auto run = [=](std::vector<string_t> pargs, string_t working_dir) {
+    auto run = [=](std::vector<string_t> pargs, string_t working_dir,
+                   py::object source) {
         string_t binary_dir = ct.attr("BINARY_DIRECTORY").cast<string_t>();
         if(working_dir.empty())
             working_dir = binary_dir;
@@ -811,10 +1697,73 @@ PYBIND11_MODULE(pyctest, ct)
         auto locals = py::dict("binary_dir"_a  = binary_dir,
                                "working_dir"_a = working_dir);
 
+        // A/B comparison with another build tree instead of a CTest run
+        string_t compare_dir = ct.attr("COMPARE_BASELINE").cast<string_t>();
+        if(!compare_dir.empty())
+        {
+            auto results = compare_trees(
+                compare_dir, binary_dir, "", "",
+                ct.attr("COMPARE_REPEAT").cast<size_t>(),
+                ct.attr("COMPARE_CPUS").cast<string_t>(), 0.95, true);
+            int ret = 0;
+            for(auto itr : results)
+                if(!itr["error"].cast<string_t>().empty())
+                    ret = 1;
+            return ret;
+        }
+
+        // stress test of the selected tests instead of a CTest run. Every
+        // test would run without its fixtures and without the limits of
+        // the CTest scheduling, so the tests have to be selected
+        size_t   stress_count = ct.attr("STRESS_COUNT").cast<size_t>();
+        string_t stress_regex = ct.attr("STRESS_REGEX").cast<string_t>();
+        if(stress_count > 0 && stress_regex.empty())
+            throw std::runtime_error("pyctest.STRESS_COUNT requires "
+                                     "pyctest.STRESS_REGEX");
+        if(stress_count > 0)
+        {
+            auto failed = stress_tests(
+                stress_regex, "", stress_count,
+                ct.attr("STRESS_JOBS").cast<size_t>(),
+                ct.attr("STRESS_SEED").cast<uint64_t>(),
+                ct.attr("STRESS_JITTER").cast<double>(), false);
+            return (failed.size() > 0) ? 1 : 0;
+        }
+
+        // the history is loaded before generating so it provides the COST
+        // of the tests and updated with the timings of this run afterwards
+        string_t history_file = ct.attr("HISTORY_FILE").cast<string_t>();
+        bool     incremental  = ct.attr("INCREMENTAL").cast<bool>();
+        if(incremental && history_file.empty())
+            history_file = working_dir + "/PyCTestHistory.txt";
+        if(!history_file.empty() && cmSystemTools::FileExists(history_file))
+            pyct::get_test_history()->Load(history_file);
+
+        // tests with unchanged inputs just echo a message with the cmake
+        // executable installed next to ctest
+        if(incremental)
+        {
+            string_t cmake_exe =
+                cmSystemTools::GetFilenamePath(exe_path()) + "/cmake";
+            pyct::get_incremental_tests()->Enable(
+                { cmake_exe, "-E", "echo",
+                  "Inputs unchanged since the last passing run (cached)" },
+                cmSystemTools::GetFilenamePath(history_file) +
+                    "/PyCTestFileHashes.txt");
+        }
+
         generate_ctest_config(working_dir);
         generate_custom_config(working_dir);
         copy_cdash(working_dir);
-        generate_test_file(working_dir);
+        // the tests of a source are only written here, the test file is
+        // generated again for every run
+        generate_test_file(working_dir,
+                           ct.attr("GENERATE_MANIFEST").cast<bool>(), source);
+        pyct::get_incremental_tests()->Disable();
+
+        size_t analyze_jobs = ct.attr("ANALYZE_JOBS").cast<size_t>();
+        if(analyze_jobs > 0)
+            analyze_tests(analyze_jobs, true);
 
         charvec_t cargs;
         // pyctest.ARGUMENTS attributes
@@ -849,8 +1798,12 @@ PYBIND11_MODULE(pyctest, ct)
                  )",
                  py::globals(), locals);
 
+        // the Python-callable tests are run by a pool forked from here
+        auto     pool   = py::module::import("pyctest.pool");
         string_t origwd = locals["origwd"].cast<string_t>();
-        int      ret    = pyct::ctest_main_driver(argc, argv);
+        pool.attr("start")();
+        int ret = pyct::ctest_main_driver(argc, argv);
+        pool.attr("stop")();
 
         locals = py::dict("working_dir"_a = origwd);
         py::exec(R"(
@@ -860,6 +1813,9 @@ PYBIND11_MODULE(pyctest, ct)
                  )",
                  py::globals(), locals);
 
+        if(!history_file.empty())
+            pyct::update_test_history(working_dir, history_file);
+
         if(ret > 0)
             std::cerr << "Error! Non-zero exit code: " << ret << std::endl;
 
@@ -1039,15 +1995,222 @@ PYBIND11_MODULE(pyctest, ct)
     ct.attr("CDASH_QUERY_VERSION") = "TRUE";
     ct.attr("TIMEOUT")             = "7200";
 
+    // run: also write CTestTestfile.manifest
+    ct.attr("GENERATE_MANIFEST") = false;
+    // generate_test_file: only write shard SHARD_INDEX of SHARD_COUNT
+    ct.attr("SHARD_INDEX") = 0;
+    ct.attr("SHARD_COUNT") = 1;
+    // generate_test_file: only write plan_tests(TIME_BUDGET, TIME_BUDGET_JOBS)
+    ct.attr("TIME_BUDGET")      = 0.0;
+    ct.attr("TIME_BUDGET_JOBS") = 1;
+    // generate_test_file: tests with PYCTEST_BATCH ("gtest", "catch2", or
+    // "pyctest") run by one process unless PYCTEST_BATCH_SIZE is set
+    ct.attr("BATCH_SIZE") = 32;
+    // generate_test_file: RESOURCE_LOCK of the tests marked flaky
+    ct.attr("FLAKY_RESOURCE_LOCK") = "";
+    // generate_test_file: report the CPU time, peak RSS, and I/O of the tests
+    ct.attr("MEASURE") = false;
+    // generate_test_file: file the values of the PYCTEST_METRICS rules
+    // ("<name>=<regex>" or "<name>=json:<path>") are appended to
+    ct.attr("METRIC_STORE") = "";
+
+    // run: test history loaded before and updated after the run
+    ct.attr("HISTORY_FILE") = "";
+    // run: only run the tests whose inputs changed since the last run
+    ct.attr("INCREMENTAL") = false;
+    // run: report the test graph for this many jobs (0 = no report)
+    ct.attr("ANALYZE_JOBS") = 0;
+    // run: compare_trees with this baseline instead of running CTest
+    ct.attr("COMPARE_BASELINE") = "";
+    ct.attr("COMPARE_REPEAT")   = 10;
+    ct.attr("COMPARE_CPUS")     = "";
+    // run: stress_tests the tests matching STRESS_REGEX instead of CTest
+    ct.attr("STRESS_COUNT")  = 0;
+    ct.attr("STRESS_REGEX")  = "";
+    ct.attr("STRESS_JOBS")   = 0;
+    ct.attr("STRESS_SEED")   = 0;
+    ct.attr("STRESS_JITTER") = 0.0;
+
+    // history (see load_test_history): tests whose peak RSS exceeds
+    // MEMORY_BUDGET (MiB) / MEMORY_JOBS reserve more PROCESSORS
+    ct.attr("MEMORY_BUDGET") = 0.0;
+    ct.attr("MEMORY_JOBS")   = 0;
+    // history: TIMEOUT = TIMEOUT_FACTOR x TIMEOUT_QUANTILE of the recent run
+    // times + TIMEOUT_FLOOR seconds, at most TIMEOUT (0 = keep the TIMEOUT)
+    ct.attr("TIMEOUT_FACTOR")   = 0.0;
+    ct.attr("TIMEOUT_QUANTILE") = 0.99;
+    ct.attr("TIMEOUT_FLOOR")    = 60.0;
+    // history: run the tests slower than PROFILE_FACTOR x their median run
+    // time (and PROFILE_FLOOR seconds more) again under PROFILE_COMMAND and
+    // submit the output as a note
+    ct.attr("PROFILE_FACTOR")  = 0.0;
+    ct.attr("PROFILE_FLOOR")   = 1.0;
+    ct.attr("PROFILE_COMMAND") = "";
+
+    // fuzz: seconds per target and directory of the kept corpora
+    ct.attr("FUZZ_TIME")             = 60.0;
+    ct.attr("FUZZ_CORPUS_DIRECTORY") = "";
+
     for(const auto& itr : blank_attr)
         ct.attr(upperstr(itr).c_str()) = "";
 
     ct.def("add_test", test_add, "Add a test");
     ct.def("remove_test", test_remove, "Remove a test");
     ct.def("find_test", test_find, "Find a test by name");
+    ct.def("reset_tests", &pyct::reset_tests,
+           "Release all tests (existing test objects become invalid)");
+    ct.def("num_allocated_tests",
+           []() { return pyct::get_test_arena()->Size(); },
+           "Number of tests currently owned by the session");
+    ct.def("num_interned_strings",
+           []() { return pyct::get_test_arena()->Strings().Size(); },
+           "Number of unique strings shared by the tests of the session");
+    ct.def("test_template", test_template,
+           "Register tests whose name, command, and property values contain "
+           "\"{key}\" placeholders expanded over the Cartesian product "
+           "(mode=\"product\") or the zip (mode=\"zip\") of the parameter "
+           "lists when the test file is generated. Returns the number of "
+           "tests",
+           py::arg("name_fmt"), py::arg("cmd_fmt"),
+           py::arg("properties") = py::dict(), py::arg("params") = py::dict(),
+           py::arg("mode") = "product", py::arg("profile") = "");
+    ct.def("discover_tests", test_discover,
+           "Add a test for each test case of GoogleTest (framework=\"gtest\") "
+           "or Catch2 (framework=\"catch2\") executables, named "
+           "\"<prefix><case>\" (the prefix defaults to the name of the "
+           "executable followed by a period). A name that is already used "
+           "raises an error. With batch > 1, up to \"batch\" cases run in "
+           "one process and report their own results. The executables are "
+           "listed in parallel (jobs=0 uses every core). Returns the new "
+           "tests",
+           py::arg("executables"), py::arg("framework") = "gtest",
+           py::arg("jobs") = 0, py::arg("prefix") = "",
+           py::arg("properties") = py::dict(), py::arg("profile") = "",
+           py::arg("args") = py::list(), py::arg("batch") = 1);
+    ct.def("benchmark", test_benchmark,
+           "Add a test that runs a command \"repeat\" times (after "
+           "\"warmup\" runs, optionally pinned to \"cpus\", e.g. \"0,2-3\") "
+           "and reports the median, MAD, and minimum time. If a baseline "
+           "file is given, the test fails when the median is slower than the "
+           "recorded one by more than \"threshold\" (and the noise of the "
+           "runs); update_baseline=True records the median instead",
+           py::arg("name"), py::arg("cmd"), py::arg("repeat") = 10,
+           py::arg("warmup") = 1, py::arg("cpus") = "",
+           py::arg("baseline") = "", py::arg("threshold") = 0.1,
+           py::arg("update_baseline") = false,
+           py::arg("properties") = py::dict(), py::arg("profile") = "");
+    ct.def("fuzz", test_fuzz,
+           "Add a test (label \"fuzz\") that runs a libFuzzer target for "
+           "\"seconds\" (default: pyctest.FUZZ_TIME) on one core. The "
+           "inputs it finds are merged into a minimized corpus kept in "
+           "\"corpus\" (default: <pyctest.FUZZ_CORPUS_DIRECTORY>/<name>) "
+           "for the next run, \"seeds\" are directories of inputs that are "
+           "only read, and a crash fails the test. The targets run in the "
+           "Fuzz stage",
+           py::arg("name"), py::arg("cmd"), py::arg("seconds") = 0.0,
+           py::arg("corpus") = "", py::arg("seeds") = py::list(),
+           py::arg("properties") = py::dict(), py::arg("profile") = "");
+    ct.def("add_profile", profile_add,
+           "Create (or update) a named set of properties shared by tests",
+           py::arg("name"), py::arg("properties") = py::dict());
     ct.def("generate_test_file", generate_test_file,
-           "Generate a CTestTestfile.cmake",
-           py::arg("output_directory") = ct.attr("BINARY_DIRECTORY"));
+           "Generate a CTestTestfile.cmake (and optionally a compact "
+           "CTestTestfile.manifest) of the registered tests or of the tests "
+           "of \"source\", an iterable of dicts (\"name\", \"cmd\", and "
+           "optionally \"properties\" and \"profile\") or of (name, cmd"
+           "[, properties]) tuples written as they are produced (not with "
+           "pyctest.SHARD_COUNT, TIME_BUDGET, or select_affected_tests)",
+           py::arg("output_directory") = ct.attr("BINARY_DIRECTORY"),
+           py::arg("manifest")         = false,
+           py::arg("source")           = py::none());
+    ct.def("shard_tests", shard_tests,
+           "Names of the tests in a shard. The tests are split by expected "
+           "run time (see load_test_history) and the split is deterministic",
+           py::arg("index"), py::arg("count"));
+    ct.def("plan_tests", plan_tests,
+           "Names of the tests that maximize the expected number of failures "
+           "caught (from the pass rates in the test history) while finishing "
+           "within 'budget' seconds on 'jobs' parallel jobs",
+           py::arg("budget"), py::arg("jobs") = 1);
+    ct.def("analyze_tests", analyze_tests,
+           "Check DEPENDS and FIXTURES_* for cycles and missing fixtures and "
+           "compute the critical path and the minimum wall time with the "
+           "given number of jobs (0 = number of cores)",
+           py::arg("jobs") = 0, py::arg("verbose") = true);
+    ct.def("compare_trees", compare_trees,
+           "Run the tests (optionally only those matching \"regex\" or "
+           "having \"label\") in two build trees, alternating the runs in "
+           "ABBA order on the same CPUs. The tests are registered for "
+           "pyctest.BINARY_DIRECTORY, which is replaced by each tree in the "
+           "commands and working directories. Returns, for each test, the "
+           "run times and the speedup of the candidate (geometric mean of the "
+           "paired ratios) with its confidence interval",
+           py::arg("baseline_dir"), py::arg("candidate_dir") = "",
+           py::arg("regex") = "", py::arg("label") = "",
+           py::arg("repeat") = 10, py::arg("cpus") = "",
+           py::arg("confidence") = 0.95, py::arg("verbose") = true);
+    ct.def("stress_tests", stress_tests,
+           "Run each test (optionally only those matching \"regex\" or "
+           "having \"label\") \"count\" times, \"jobs\" at a time (0 = "
+           "one per CPU), to reproduce rare failures. Run i gets "
+           "PYCTEST_STRESS_ITERATION=i and PYCTEST_STRESS_SEED=seed+i (a "
+           "random seed if 0) and starts after a random delay of up to "
+           "\"jitter\" milliseconds. The runs of a test stop at its first "
+           "failure (unless keep_going) and the failure rate and the output "
+           "of the failing run are reported. Returns the tests that failed",
+           py::arg("regex") = "", py::arg("label") = "",
+           py::arg("count") = 100, py::arg("jobs") = 0, py::arg("seed") = 0,
+           py::arg("jitter") = 0.0, py::arg("keep_going") = false);
+    ct.def("load_test_manifest", load_test_manifest,
+           "Add the tests in a CTestTestfile.manifest to the test list",
+           py::arg("filename"));
+    ct.def("select_affected_tests", select_affected,
+           "Only generate the tests affected by the files changed between "
+           "two git revisions (head=\"\" compares with the working tree). "
+           "Files are associated with tests by the PYCTEST_SOURCES globs, the "
+           "label globs (see add_label_sources), and an optional coverage "
+           "map (\"<test>\\t<file>\" lines). Returns the changed files",
+           py::arg("base"), py::arg("head") = "", py::arg("source_dir") = "",
+           py::arg("coverage_map") = "", py::arg("fallback") = true);
+    ct.def("add_label_sources", add_label_sources,
+           "Associate source file globs with the tests having a label",
+           py::arg("label"), py::arg("globs"));
+    ct.def("limit_label_concurrency",
+           [](string_t label, size_t count) {
+               pyct::get_label_limits()->SetLimit(label, count);
+           },
+           "Run at most 'count' tests with the label at the same time "
+           "(0 = unlimited). Enforced with RESOURCE_LOCK properties assigned "
+           "when the test file is generated",
+           py::arg("label"), py::arg("count"));
+    ct.def("load_test_history", load_test_history,
+           "Load test timings (CTestCostData.txt or a pyctest history file) "
+           "used to set the COST (and PROCESSORS) of the generated tests. "
+           "Returns the number of tests in the history",
+           py::arg("filename"));
+    ct.def("save_test_history",
+           [](string_t fname) {
+               return pyct::get_test_history()->Write(fname);
+           },
+           "Save the test history", py::arg("filename"));
+    ct.def("update_test_history", &pyct::update_test_history,
+           "Merge Testing/Temporary/CTestCostData.txt, the test results and "
+           "times, and the re-runs of the failed tests of a directory into "
+           "the test history and optionally save it. Tests whose time drifted "
+           "from the median of their recent runs are reported",
+           py::arg("directory"), py::arg("filename") = "");
+    ct.def("flaky_tests",
+           []() {
+               py::dict _flaky;
+               for(const auto& itr : pyct::get_test_history()->Records())
+                   if(itr.second.IsFlaky())
+                       _flaky[itr.first.c_str()] = itr.second.PassRate();
+               return _flaky;
+           },
+           "Tests of the history that recently passed only when re-run and "
+           "their pass rate");
+    ct.def("clear_test_history", []() { pyct::get_test_history()->Clear(); },
+           "Forget all the test timings");
     ct.def("copy_files", copy_files,
            "Helper method to copy files over to binary dir",
            py::arg("files") = py::list(), py::arg("from_dir") = "",
@@ -1069,12 +2232,24 @@ PYBIND11_MODULE(pyctest, ct)
            py::arg("dir") = "", py::arg("file") = "",
            py::arg("clobber") = false);
     ct.def("exe_path", exe_path, "Path to ctest executable");
-    ct.def("run", run, "Run CTest", py::arg("args") = ct.attr("ARGUMENTS"),
-           py::arg("working_directory") = ct.attr("BINARY_DIRECTORY"));
+    ct.def("run", run,
+           "Run CTest (or compare_trees with pyctest.COMPARE_BASELINE or "
+           "stress_tests of the tests matching pyctest.STRESS_REGEX with "
+           "pyctest.STRESS_COUNT if set). The test file "
+           "is generated first, with the tests of \"source\" (see "
+           "generate_test_file) if given",
+           py::arg("args") = ct.attr("ARGUMENTS"),
+           py::arg("working_directory") = ct.attr("BINARY_DIRECTORY"),
+           py::arg("source")            = py::none());
     ct.def("execute", execute, "Directly run ctest", py::arg("args") = py::list());
 
-    _test.def(py::init(test_init), "Test for CTest", py::arg("name") = "",
-              py::arg("cmd") = py::list(), py::arg("properties") = py::dict());
+    _test.def(py::init(test_init),
+              "Test for CTest. The command can also be a Python callable or "
+              "\"module:function\" (optionally followed by its arguments), "
+              "run by the pyctest.pool worker pool",
+              py::arg("name") = "",
+              py::arg("cmd") = py::list(), py::arg("properties") = py::dict(),
+              py::arg("profile") = "");
     _test.def("SetName", &pyct::set_name, "Set test name");
     _test.def("GetName", &pyct::get_name, "Get test name");
     _test.def("SetCommand", &pyct::set_command, "Set the command for the test");
@@ -1083,6 +2258,9 @@ PYBIND11_MODULE(pyctest, ct)
     _test.def("GetProperty", &pyct::get_property, "Get a test property");
     _test.def("GetPropertyAsBool", &pyct::get_property_as_bool,
               "Get property as boolean");
+    _test.def("SetProfile", test_set_profile,
+              "Use the default properties of a profile (see add_profile)");
+    _test.def("GetProfile", test_get_profile, "Get the profile name");
 
     _var.def(py::init(var_init), "Set a variable in CTestInit.cmake",
              py::arg("variable") = "", py::arg("value") = "",
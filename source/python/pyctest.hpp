@@ -80,6 +80,7 @@
 #include <sstream>
 #include <string>
 // general
+#include <algorithm>
 #include <chrono>
 #include <exception>
 #include <functional>
@@ -90,6 +91,7 @@
 #include <deque>
 #include <map>
 #include <set>
+#include <unordered_set>
 #include <vector>
 // threading
 #include <atomic>
@@ -103,6 +105,9 @@
 #    include <string.h>
 #    include <sys/stat.h>
 #    include <sys/types.h>
+#    if defined(_LINUX)
+#        include <sched.h>
+#    endif
 #elif defined(_WINDOWS)
 #    include <direct.h>
 #    ifndef NOMINMAX
@@ -137,6 +142,7 @@ consume_parameters(_Tp, _Args...)
 #include "CTest/cmCTestLaunch.h"
 #include "CTest/cmCTestScriptHandler.h"
 #include "cmCTest.h"
+#include "cmCryptoHash.h"
 #include "cmDocumentation.h"
 #include "cmGeneratorExpression.h"
 #include "cmGeneratorTarget.h"
@@ -151,6 +157,7 @@ consume_parameters(_Tp, _Args...)
 #include "cmTestGenerator.h"
 #include "cmake.h"
 #include "cmsys/Encoding.hxx"
+#include "cmsys/RegularExpression.hxx"
 #if defined(_WIN32)
 #    include "cmsys/ConsoleBuf.hxx"
 #endif
@@ -206,13 +213,16 @@ makedir(std::string _dir, int umask = DEFAULT_UMASK)
 //============================================================================//
 
 #include "pycmExecuteProcessCommand.hpp"
+#include "pycmTestHistory.hpp"
 
 namespace pyct
 {
 //----------------------------------------------------------------------------//
 // forward declarations
 class pycmTest;
+class pycmTestArena;
 class pycmTestGenerator;
+class pycmTestTemplate;
 class pycmVariable;
 int
 ctest_main_driver(int argc, char const* const* argv);
@@ -220,9 +230,15 @@ ctest_main_driver(int argc, char const* const* argv);
 // typedefs
 typedef std::string                     string_t;
 typedef std::vector<string_t>           strvec_t;
+typedef std::pair<string_t, string_t>   strpair_t;
+typedef std::vector<strpair_t>          strpair_list_t;
 typedef std::vector<pycmTest*>          test_list_t;
 typedef std::vector<pycmVariable*>      test_variable_list_t;
 typedef std::vector<pycmTestGenerator*> test_generator_list_t;
+typedef std::deque<pycmTestTemplate>    test_template_list_t;
+typedef std::function<bool(const pycmTest*)> test_filter_t;
+// fills a scratch test with the next test, false once there are no more
+typedef std::function<bool(pycmTest*)> test_source_t;
 //----------------------------------------------------------------------------//
 template <typename _Tp> class pycmWrapper
 {
@@ -239,13 +255,140 @@ protected:
     _Tp* m_type;
 };
 //----------------------------------------------------------------------------//
+// interned strings -- identical commands, paths and property values are
+// stored once per session and tests refer to them by pointer. Elements of an
+// unordered_set are never relocated so the pointers remain valid until the
+// pool is cleared
+class pycmStringPool
+{
+public:
+    typedef const string_t* istring_t;
+
+public:
+    istring_t Intern(const string_t& val)
+    {
+        return &*m_strings.insert(val).first;
+    }
+    void   Clear() { std::unordered_set<string_t>().swap(m_strings); }
+    size_t Size() const { return m_strings.size(); }
+
+private:
+    std::unordered_set<string_t> m_strings;
+};
+//----------------------------------------------------------------------------//
+// sorted list of interned (property, value) pairs. Replaces cmPropertyMap
+// for tests so that neither the keys nor the values are duplicated
+class pycmPropertyList
+{
+public:
+    typedef pycmStringPool::istring_t       istring_t;
+    typedef std::pair<istring_t, istring_t> entry_t;
+    typedef std::vector<entry_t>            storage_t;
+    typedef storage_t::const_iterator       const_iterator;
+
+public:
+    // a null value removes the property (same as cmPropertyMap)
+    void Set(pycmStringPool* pool, const string_t& prop, const char* value)
+    {
+        auto itr = Find(prop);
+        bool has = (itr != m_props.end() && *itr->first == prop);
+        if(!value)
+        {
+            if(has)
+                m_props.erase(itr);
+            return;
+        }
+        if(has)
+            itr->second = pool->Intern(value);
+        else
+            m_props.insert(itr,
+                           entry_t(pool->Intern(prop), pool->Intern(value)));
+    }
+
+    void Append(pycmStringPool* pool, const string_t& prop, const char* value,
+                bool asString)
+    {
+        istring_t cur = Get(prop);
+        if(!value || !cur)
+            return Set(pool, prop, value);
+        string_t val = *cur;
+        if(!val.empty() && *value && !asString)
+            val += ";";
+        val += value;
+        Set(pool, prop, val.c_str());
+    }
+
+    istring_t Get(const string_t& prop) const
+    {
+        auto itr = Find(prop);
+        return (itr != m_props.end() && *itr->first == prop) ? itr->second
+                                                             : nullptr;
+    }
+
+    bool           empty() const { return m_props.empty(); }
+    size_t         size() const { return m_props.size(); }
+    const_iterator begin() const { return m_props.begin(); }
+    const_iterator end() const { return m_props.end(); }
+
+private:
+    storage_t::iterator Find(const string_t& prop)
+    {
+        return std::lower_bound(m_props.begin(), m_props.end(), prop,
+                                [](const entry_t& lhs, const string_t& rhs) {
+                                    return *lhs.first < rhs;
+                                });
+    }
+    storage_t::const_iterator Find(const string_t& prop) const
+    {
+        return const_cast<pycmPropertyList*>(this)->Find(prop);
+    }
+
+private:
+    storage_t m_props;
+};
+//----------------------------------------------------------------------------//
+// a named set of default properties shared by many tests
+class pycmTestProfile
+{
+public:
+    pycmTestProfile(pycmStringPool* pool, const string_t& name)
+    : m_strings(pool)
+    , m_name(name)
+    {
+    }
+
+    const string_t& GetName() const { return m_name; }
+
+    void SetProperty(const string_t& prop, const char* value)
+    {
+        m_properties.Set(m_strings, prop, value);
+    }
+    const char* GetProperty(const string_t& prop) const
+    {
+        auto val = m_properties.Get(prop);
+        return (val) ? val->c_str() : nullptr;
+    }
+    const pycmPropertyList& GetProperties() const { return m_properties; }
+
+private:
+    pycmStringPool*  m_strings;
+    string_t         m_name;
+    pycmPropertyList m_properties;
+};
+//----------------------------------------------------------------------------//
 class pycmTest
 {
 public:
-    pycmTest(string_t name = "", strvec_t cmd = strvec_t())
-    : m_name(name)
-    , m_command(cmd)
+    typedef pycmStringPool::istring_t istring_t;
+
+public:
+    pycmTest(pycmStringPool* pool, string_t name = "",
+             strvec_t cmd = strvec_t())
+    : m_strings(pool)
+    , m_profile(nullptr)
+    , m_name(name)
     {
+        SetCommand(cmd);
     }
 
     ~pycmTest() {}
@@ -257,36 +400,269 @@ public:
     // command
     void SetCommand(std::vector<string_t> const& command)
     {
-        m_command = command;
+        m_command.clear();
+        m_command.reserve(command.size());
+        for(const auto& itr : command)
+            m_command.push_back(m_strings->Intern(itr));
+    }
+    std::vector<string_t> GetCommand() const
+    {
+        std::vector<string_t> _command;
+        _command.reserve(m_command.size());
+        for(const auto& itr : m_command)
+            _command.push_back(*itr);
+        return _command;
     }
-    std::vector<string_t> const& GetCommand() const { return m_command; }
 
-    // properties
+    // profile
+    void SetProfile(pycmTestProfile* profile) { m_profile = profile; }
+    pycmTestProfile* GetProfile() const { return m_profile; }
+
+    // properties (set on the test, override the profile)
     void SetProperty(const string_t& prop, const char* value)
     {
-        m_properties.SetProperty(prop, value);
+        m_properties.Set(m_strings, prop, value);
     }
     void AppendProperty(const string_t& prop, const char* value,
                         bool asString = false)
     {
-        m_properties.AppendProperty(prop, value, asString);
+        // start from the profile value so appending extends the default
+        if(!m_properties.Get(prop) && m_profile && m_profile->GetProperty(prop))
+            SetProperty(prop, m_profile->GetProperty(prop));
+        m_properties.Append(m_strings, prop, value, asString);
     }
     const char* GetProperty(const string_t& prop) const
     {
-        return m_properties.GetPropertyValue(prop);
+        auto val = m_properties.Get(prop);
+        if(val)
+            return val->c_str();
+        return (m_profile) ? m_profile->GetProperty(prop) : nullptr;
     }
     bool GetPropertyAsBool(const string_t& prop) const
     {
         return cmSystemTools::IsOn(this->GetProperty(prop));
     }
-    cmPropertyMap& GetProperties() { return m_properties; }
+    const pycmPropertyList& GetProperties() const { return m_properties; }
+
+private:
+    pycmStringPool*        m_strings;
+    pycmTestProfile*       m_profile;
+    pycmPropertyList       m_properties;
+    string_t               m_name;
+    std::vector<istring_t> m_command;
+};
+//----------------------------------------------------------------------------//
+// a test name, command, and properties containing "{key}" placeholders that
+// are expanded over a grid of parameters when the test file is generated.
+// Placeholders that do not name a parameter (e.g. CMake "${VAR}" references)
+// are left untouched
+class pycmTestTemplate
+{
+public:
+    enum class mode_t
+    {
+        PRODUCT,
+        ZIP
+    };
+
+    typedef std::pair<string_t, string_t> strpair_t;
+    typedef std::vector<strpair_t>        strpair_list_t;
+    typedef std::pair<string_t, strvec_t> param_t;
+    typedef std::vector<param_t>          param_list_t;
+
+public:
+    pycmTestTemplate(const string_t& name_fmt, const strvec_t& cmd_fmt,
+                     const strpair_list_t& props, const param_list_t& params,
+                     mode_t mode, pycmTestProfile* profile)
+    : m_name(name_fmt)
+    , m_command(cmd_fmt)
+    , m_properties(props)
+    , m_params(params)
+    , m_mode(mode)
+    , m_profile(profile)
+    {
+        if(m_mode == mode_t::ZIP)
+        {
+            for(const auto& itr : m_params)
+                if(itr.second.size() != m_params.front().second.size())
+                    throw std::runtime_error(
+                        "test_template: zipped parameters must have the same "
+                        "number of values");
+        }
+    }
+
+    // number of tests the template expands to (a single test without any
+    // parameters)
+    size_t Size() const
+    {
+        if(m_params.empty())
+            return 1;
+        if(m_mode == mode_t::ZIP)
+            return m_params.front().second.size();
+        size_t _n = 1;
+        for(const auto& itr : m_params)
+            _n *= itr.second.size();
+        return _n;
+    }
+
+    pycmTestProfile* GetProfile() const { return m_profile; }
+
+    // fill "test" with the i-th expansion. Product expansion varies the last
+    // parameter fastest (same as itertools.product)
+    void Expand(size_t i, pycmTest* test) const
+    {
+        strpair_list_t _values(m_params.size());
+        for(size_t j = m_params.size(); j > 0; --j)
+        {
+            const param_t& _param = m_params.at(j - 1);
+            size_t         _n     = _param.second.size();
+            size_t         _idx   = (m_mode == mode_t::ZIP) ? i : (i % _n);
+            _values[j - 1] = strpair_t(_param.first, _param.second.at(_idx));
+            if(m_mode == mode_t::PRODUCT)
+                i /= _n;
+        }
+
+        strvec_t _command;
+        _command.reserve(m_command.size());
+        for(const auto& itr : m_command)
+            _command.push_back(Format(itr, _values));
+
+        test->SetName(Format(m_name, _values));
+        test->SetCommand(_command);
+        test->SetProfile(m_profile);
+        for(const auto& itr : m_properties)
+            test->SetProperty(itr.first, Format(itr.second, _values).c_str());
+    }
+
+    // replace every "{key}" in a single pass from left to right so the
+    // substituted values are never formatted again. Any other brace is kept
+    static string_t Format(const string_t& fmt, const strpair_list_t& values)
+    {
+        string_t _str;
+        _str.reserve(fmt.length());
+        size_t _pos = 0;
+        while(_pos < fmt.length())
+        {
+            size_t _beg = fmt.find('{', _pos);
+            size_t _end = (_beg == string_t::npos) ? _beg
+                                                   : fmt.find('}', _beg + 1);
+            if(_end == string_t::npos)
+                break;
+
+            const strpair_t* _value = nullptr;
+            for(const auto& itr : values)
+            {
+                if(fmt.compare(_beg + 1, _end - _beg - 1, itr.first) == 0)
+                {
+                    _value = &itr;
+                    break;
+                }
+            }
+
+            _str.append(fmt, _pos, _beg - _pos);
+            if(_value)
+            {
+                _str.append(_value->second);
+                _pos = _end + 1;
+            }
+            else
+            {
+                _str.push_back('{');
+                _pos = _beg + 1;
+            }
+        }
+        _str.append(fmt, _pos, string_t::npos);
+        return _str;
+    }
+
+private:
+    string_t         m_name;
+    strvec_t         m_command;
+    strpair_list_t   m_properties;
+    param_list_t     m_params;
+    mode_t           m_mode;
+    pycmTestProfile* m_profile;
+};
+//----------------------------------------------------------------------------//
+// owns every pycmTest, profile, template, and interned string created during
+// a session.
+// Tests are stored in a deque so the pointers held by the test list and the
+// Python wrappers stay valid until the arena is cleared. Clearing bumps the
+// generation so that stale Python wrappers raise instead of dereferencing
+// freed memory
+class pycmTestArena
+{
+public:
+    typedef std::deque<pycmTest>                storage_t;
+    typedef std::map<string_t, pycmTestProfile> profile_map_t;
+    typedef std::deque<pycmTestTemplate>        template_list_t;
+
+public:
+    pycmTestArena()
+    : m_generation(0)
+    {
+    }
+
+    pycmTest* Create(const string_t& name = "",
+                     const strvec_t& cmd  = strvec_t())
+    {
+        m_tests.emplace_back(&m_strings, name, cmd);
+        return &m_tests.back();
+    }
+
+    pycmTestTemplate* AddTemplate(const pycmTestTemplate& _template)
+    {
+        m_templates.push_back(_template);
+        return &m_templates.back();
+    }
+
+    // returns nullptr if "create" is false and the profile does not exist
+    pycmTestProfile* GetProfile(const string_t& name, bool create = true)
+    {
+        auto itr = m_profiles.find(name);
+        if(itr == m_profiles.end())
+        {
+            if(!create)
+                return nullptr;
+            itr = m_profiles
+                      .insert(std::make_pair(name,
+                                             pycmTestProfile(&m_strings, name)))
+                      .first;
+        }
+        return &itr->second;
+    }
+
+    void Clear()
+    {
+        // swap with empty containers so the memory is actually released
+        storage_t().swap(m_tests);
+        profile_map_t().swap(m_profiles);
+        template_list_t().swap(m_templates);
+        m_strings.Clear();
+        ++m_generation;
+    }
+
+    size_t           Size() const { return m_tests.size(); }
+    uint64_t         Generation() const { return m_generation; }
+    pycmStringPool&  Strings() { return m_strings; }
+    template_list_t& Templates() { return m_templates; }
 
 private:
-    cmPropertyMap         m_properties;
-    string_t              m_name;
-    std::vector<string_t> m_command;
+    pycmStringPool  m_strings;
+    storage_t       m_tests;
+    profile_map_t   m_profiles;
+    template_list_t m_templates;
+    uint64_t        m_generation;
 };
 //----------------------------------------------------------------------------//
+pycmTestArena*
+get_test_arena()
+{
+    typedef std::shared_ptr<pycmTestArena> ptr_t;
+    static ptr_t _instance = ptr_t(new pycmTestArena());
+    return _instance.get();
+}
+//----------------------------------------------------------------------------//
 class pycmTestWrapper : public pycmWrapper<pycmTest>
 {
 public:
@@ -295,8 +671,20 @@ public:
 public:
     pycmTestWrapper(pycmTest* test)
     : wrapper_t(test)
+    , m_generation(get_test_arena()->Generation())
+    {
+    }
+
+    pycmTest* get() const
     {
+        if(m_generation != get_test_arena()->Generation())
+            throw std::runtime_error(
+                "pyctest.test object is no longer valid (tests were reset)");
+        return m_type;
     }
+
+private:
+    uint64_t m_generation;
 };
 //----------------------------------------------------------------------------//
 class pycmTestGenerator : public cmScriptGenerator
@@ -310,6 +698,20 @@ public:
 
     pycmTest* GetTest() const;
 
+    /** Write set_tests_properties(...) for the properties set on the test.
+        Profile properties are written once per profile by write_test_file */
+    void GenerateProperties(std::ostream& os, Indent indent = Indent());
+
+    /** Defer GenerateProperties(...) until all tests have been added.  */
+    void SetDeferProperties(bool val) { m_defer_properties = val; }
+
+    /** Properties written after the ones set on the test (e.g. the COST
+        derived from the test history) */
+    void SetDerivedProperties(const strpair_list_t& val) { m_derived = val; }
+
+    /** Write this command instead of the command of the test  */
+    void SetCommand(const strvec_t& val) { m_command = val; }
+
 protected:
     void GenerateScriptConfigs(std::ostream& os, Indent indent);
     void GenerateScriptActions(std::ostream& os, Indent indent);
@@ -319,8 +721,71 @@ protected:
     bool NeedsScriptNoConfig() const;
     void GenerateOldStyle(std::ostream& os, Indent indent);
 
-    pycmTest* m_test;
-    bool      m_test_generated;
+    strvec_t GetCommand() const;
+
+    pycmTest*      m_test;
+    bool           m_test_generated;
+    bool           m_defer_properties;
+    strpair_list_t m_derived;
+    strvec_t       m_command;
+};
+//----------------------------------------------------------------------------//
+// ordering constraints between the tests: DEPENDS, and fixture setup tests
+// before the tests requiring the fixture before the cleanup tests. Tests
+// sharing a RESOURCE_LOCK are not ordered but can never run concurrently
+class pycmTestGraph
+{
+public:
+    typedef std::vector<size_t>          index_list_t;
+    typedef std::map<string_t, strvec_t> strvec_map_t;
+
+    struct node_t
+    {
+        string_t     name;
+        double       cost;
+        long         processors;
+        index_list_t edges;  // tests that must run after this one
+    };
+
+public:
+    /** Build the graph of the tests and template expansions. The cost of
+        each test is taken from estimate_test_cost(...)  */
+    void Build(test_list_t* test_list, const test_template_list_t* templates);
+
+    /** Groups of tests that depend on each other (cannot be scheduled)  */
+    const std::vector<strvec_t>& Cycles() const { return m_cycles; }
+    /** Fixtures required by tests that no test sets up or cleans up  */
+    const strvec_map_t& MissingFixtures() const { return m_missing_fixtures; }
+    /** DEPENDS entries that do not name a test  */
+    const strvec_map_t& UnknownDepends() const { return m_unknown_depends; }
+
+    /** Longest chain of tests (by cost) that must run one after the other  */
+    strvec_t CriticalPath(double* length = nullptr) const;
+    /** Sum of cost x processors (the processors are capped at "jobs")  */
+    double TotalWork(size_t jobs) const;
+    /** Total cost of the tests holding the busiest RESOURCE_LOCK  */
+    double MaxLockTime(string_t* lock = nullptr) const;
+    /** Lower bound of the wall time of "ctest -j<jobs>"  */
+    double MinWallTime(size_t jobs) const;
+    /** Smallest number of jobs reaching the lower bound of the wall time  */
+    size_t MaxUsefulJobs() const;
+
+    void Report(std::ostream& os, size_t jobs) const;
+
+    size_t        Size() const { return m_nodes.size(); }
+    size_t        NumEdges() const;
+    const node_t& GetNode(size_t i) const { return m_nodes.at(i); }
+
+private:
+    void FindCycles();
+
+private:
+    std::vector<node_t>        m_nodes;
+    std::map<string_t, double> m_locks;
+    std::vector<strvec_t>      m_cycles;
+    std::vector<bool>          m_in_cycle;
+    strvec_map_t               m_missing_fixtures;
+    strvec_map_t               m_unknown_depends;
 };
 //----------------------------------------------------------------------------//
 class pycmVariable
@@ -467,6 +932,14 @@ get_test_variables()
     return _instance.get();
 }
 //----------------------------------------------------------------------------//
+pycmTestHistory*
+get_test_history()
+{
+    typedef std::shared_ptr<pycmTestHistory> ptr_t;
+    static ptr_t _instance = ptr_t(new pycmTestHistory());
+    return _instance.get();
+}
+//----------------------------------------------------------------------------//
 strvec_t&
 get_config_attributes()
 {
@@ -550,7 +1023,8 @@ string_t
 get_property(py::object self, string_t prop)
 {
     pyobj_cast(_self, pycmTestWrapper, self);
-    return string_t(_self->get()->GetProperty(prop));
+    const char* val = _self->get()->GetProperty(prop);
+    return (val) ? string_t(val) : string_t("");
 }
 //----------------------------------------------------------------------------//
 bool
@@ -583,41 +1057,2852 @@ configure_filepath(string_t& dir, string_t& fname)
     }
 }
 //----------------------------------------------------------------------------//
+// quote an argument for the shell used by popen(...)
+string_t
+quote_shell_argument(const string_t& arg)
+{
+#if defined(_WINDOWS)
+    string_t _quoted = "\"";
+    for(char c : arg)
+    {
+        if(c == '"')
+            _quoted += '\\';
+        _quoted += c;
+    }
+    return _quoted + "\"";
+#else
+    string_t _quoted = "'";
+    for(char c : arg)
+    {
+        if(c == '\'')
+            _quoted += "'\\''";
+        else
+            _quoted += c;
+    }
+    return _quoted + "'";
+#endif
+}
+//----------------------------------------------------------------------------//
+// run "cmd" and capture its standard output (standard error is discarded).
+// Uses popen(...) instead of cmsysProcess so that several commands can be
+// run from different threads at the same time
+bool
+capture_output(const strvec_t& cmd, string_t& output)
+{
+    std::stringstream ss;
+    for(const auto& itr : cmd)
+        ss << quote_shell_argument(itr) << " ";
+#if defined(_WINDOWS)
+    // cmd.exe strips the outer quotes of the command line
+    string_t _cmd = "\"" + ss.str() + "2>NUL\"";
+    FILE*    _fp  = _popen(_cmd.c_str(), "r");
+#else
+    string_t _cmd = ss.str() + "2>/dev/null";
+    FILE*    _fp  = popen(_cmd.c_str(), "r");
+#endif
+    if(!_fp)
+        return false;
+
+    char   _buffer[4096];
+    size_t _n = 0;
+    while((_n = fread(_buffer, 1, sizeof(_buffer), _fp)) > 0)
+        output.append(_buffer, _n);
+
+#if defined(_WINDOWS)
+    return (_pclose(_fp) == 0);
+#else
+    return (pclose(_fp) == 0);
+#endif
+}
+//----------------------------------------------------------------------------//
+// split into lines without the trailing carriage returns
+strvec_t
+split_lines(const string_t& output)
+{
+    strvec_t          _lines;
+    string_t          _line;
+    std::stringstream ss(output);
+    while(std::getline(ss, _line))
+    {
+        if(!_line.empty() && _line.back() == '\r')
+            _line.pop_back();
+        _lines.push_back(_line);
+    }
+    return _lines;
+}
+//----------------------------------------------------------------------------//
+//
+//  Compact test manifest
+//
+//  Every field is written as "<length>:<bytes>" so the manifest can be loaded
+//  without tokenizing CMake syntax and without escaping any characters.
+//  A test is written as it was registered (its own command and properties,
+//  not those of the generated test file, e.g. of a batch or of a cached run)
+//  so it loads back into the same test. Profiles are written before the
+//  tests that reference them:
+//
+//      pyctest-manifest <version>
+//      P <name> <nprops> <key> <value>...
+//      T <name> <profile> <argc> <arg>... <nprops> <key> <value>...
+//
+//----------------------------------------------------------------------------//
+const string_t&
+get_manifest_header()
+{
+    static string_t _instance = "pyctest-manifest 2";
+    return _instance;
+}
+//----------------------------------------------------------------------------//
 void
-generate_test_file(string_t dir = "")
+manifest_write_field(std::ostream& os, const string_t& field)
 {
-    string_t fname = "CTestTestfile.cmake";
-    configure_filepath(dir, fname);
+    os << field.length() << ':' << field << ' ';
+}
+//----------------------------------------------------------------------------//
+void
+manifest_write_profile(std::ostream& os, const pycmTestProfile* profile)
+{
+    const pycmPropertyList& pm = profile->GetProperties();
+    os << "P ";
+    manifest_write_field(os, profile->GetName());
+    os << pm.size() << ' ';
+    for(auto const& i : pm)
+    {
+        manifest_write_field(os, *i.first);
+        manifest_write_field(os, *i.second);
+    }
+    os << '\n';
+}
+//----------------------------------------------------------------------------//
+void
+manifest_write_test(std::ostream& os, const pycmTest* test)
+{
+    const strvec_t&         command = test->GetCommand();
+    const pycmPropertyList& pm      = test->GetProperties();
+    pycmTestProfile*        profile = test->GetProfile();
 
-    auto test_list = get_test_list();
-    if(!test_list || (test_list && test_list->size() == 0))
+    os << "T ";
+    manifest_write_field(os, test->GetName());
+    manifest_write_field(os, (profile) ? profile->GetName() : string_t(""));
+    os << command.size() << ' ';
+    for(const auto& itr : command)
+        manifest_write_field(os, itr);
+    os << pm.size() << ' ';
+    for(auto const& i : pm)
     {
-        std::cerr << __FUNCTION__ << ":: Warning! No tests to generate!!!"
-                  << std::endl;
+        manifest_write_field(os, *i.first);
+        manifest_write_field(os, *i.second);
     }
-    else
+    os << '\n';
+}
+//----------------------------------------------------------------------------//
+bool
+manifest_read_field(std::istream& is, string_t& field)
+{
+    size_t len = 0;
+    char   sep = '\0';
+    if(!(is >> len) || !is.get(sep) || sep != ':')
+        return false;
+    field.resize(len);
+    return (len == 0 || is.read(&field[0], len)) ? true : false;
+}
+//----------------------------------------------------------------------------//
+// read a manifest written by generate_test_file and append the tests to
+// "test_list" (the tests are owned by "arena"). Returns the number of tests
+// read or -1 if the file is not a valid manifest, in which case neither the
+// list nor the arena is modified
+int
+load_test_manifest(const string_t& fname, test_list_t* test_list,
+                   pycmTestArena* arena)
+{
+    std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    if(!ifs || !test_list || !arena)
+        return -1;
+
+    string_t header;
+    std::getline(ifs, header);
+    if(header != get_manifest_header())
     {
-        std::ofstream         ofs(fname.c_str());
-        test_generator_list_t generator_list;
-        if(ofs)
-        {
-            std::cout << "Writing CTest test file: \"" << fname << "\"..."
-                      << std::endl;
-            strvec_t configs(0, "");
-            for(auto itr : *test_list)
-                generator_list.push_back(new pycmTestGenerator(itr));
+        std::cerr << __FUNCTION__ << ":: Error! \"" << fname
+                  << "\" is not a pyctest manifest (header: \"" << header
+                  << "\")" << std::endl;
+        return -1;
+    }
 
-            for(auto& itr : generator_list)
-            {
-                std::cout << "Generating test \"" << itr->GetTest()->GetName()
-                          << "\"..." << std::endl;
-                itr->Generate(ofs, "", configs);
-            }
+    // reads "<nprops> <key> <value>..." of a test or profile
+    auto read_properties = [&ifs](strpair_list_t& props) {
+        size_t nprop = 0;
+        if(!(ifs >> nprop))
+            return false;
+        props.resize(nprop);
+        for(auto& itr : props)
+            if(!manifest_read_field(ifs, itr.first) ||
+               !manifest_read_field(ifs, itr.second))
+                return false;
+        return true;
+    };
+
+    // the whole file is parsed before anything is added
+    struct entry_t
+    {
+        string_t       name;
+        string_t       profile;
+        strvec_t       args;
+        strpair_list_t props;
+    };
+
+    std::vector<entry_t> profiles;
+    std::vector<entry_t> tests;
+    char                 type = '\0';
+    while(ifs >> type)
+    {
+        if(type != 'P' && type != 'T')
+            return -1;
+
+        entry_t entry;
+        size_t  nargs = 0;
+        if(!manifest_read_field(ifs, entry.name))
+            return -1;
+        if(type == 'T')
+        {
+            if(!manifest_read_field(ifs, entry.profile) || !(ifs >> nargs))
+                return -1;
+            entry.args.resize(nargs);
+            for(auto& itr : entry.args)
+                if(!manifest_read_field(ifs, itr))
+                    return -1;
         }
-        else
-            std::cerr << __FUNCTION__ << ":: Error opening " << fname << "!!!"
-                      << std::endl;
+        if(!read_properties(entry.props))
+            return -1;
+        ((type == 'P') ? profiles : tests).push_back(std::move(entry));
+    }
+
+    for(const auto& itr : profiles)
+    {
+        auto profile = arena->GetProfile(itr.name);
+        for(const auto& prop : itr.props)
+            profile->SetProperty(prop.first, prop.second.c_str());
+    }
+    for(const auto& itr : tests)
+    {
+        auto obj = arena->Create(itr.name, itr.args);
+        if(!itr.profile.empty())
+            obj->SetProfile(arena->GetProfile(itr.profile));
+        for(const auto& prop : itr.props)
+            obj->SetProperty(prop.first, prop.second.c_str());
+        test_list->push_back(obj);
+    }
+    return static_cast<int>(tests.size());
+}
+//----------------------------------------------------------------------------//
+// the elements of a ;-separated list property
+strvec_t
+get_list_property(const pycmTest* test, const string_t& prop)
+{
+    strvec_t    _list;
+    const char* _val = test->GetProperty(prop);
+    if(_val)
+        cmSystemTools::ExpandListArgument(_val, _list);
+    return _list;
+}
+//----------------------------------------------------------------------------//
+// the tests whose name matches "regex" (if not empty) and which have the
+// label "label" (if not empty)
+test_filter_t
+name_label_filter(const string_t& regex, const string_t& label)
+{
+    auto _regex = std::make_shared<cmsys::RegularExpression>();
+    if(!regex.empty() && !_regex->compile(regex))
+        throw std::runtime_error("Invalid regular expression: \"" + regex +
+                                 "\"");
+
+    return [=](const pycmTest* test) {
+        if(!regex.empty() && !_regex->find(test->GetName()))
+            return false;
+        if(label.empty())
+            return true;
+        auto _labels = get_list_property(test, "LABELS");
+        return std::find(_labels.begin(), _labels.end(), label) !=
+               _labels.end();
+    };
+}
+//----------------------------------------------------------------------------//
+// CTest test names cannot contain spaces, quotes, or semicolons
+string_t
+sanitize_test_name(string_t name)
+{
+    for(auto& itr : name)
+        if(isspace(itr) || itr == '"' || itr == ';' || itr == '(' ||
+           itr == ')' || itr == '#' || itr == '\\')
+            itr = '_';
+    return name;
+}
+//----------------------------------------------------------------------------//
+// the command of a test run by pyctest-launcher (e.g. a benchmark) without
+// the launcher and its options
+strvec_t
+strip_launcher(strvec_t cmd)
+{
+    if(!cmd.empty() &&
+       cmSystemTools::GetFilenameName(cmd.front()) == "pyctest-launcher")
+    {
+        auto _sep = std::find(cmd.begin(), cmd.end(), "--");
+        cmd.erase(cmd.begin(),
+                  (_sep == cmd.end()) ? cmd.begin() + 1 : _sep + 1);
+    }
+    return cmd;
+}
+//----------------------------------------------------------------------------//
+// true if the command runs through pyctest-launcher with the option "opt"
+bool
+has_launcher_option(const strvec_t& cmd, const string_t& opt)
+{
+    auto _sep = std::find(cmd.begin(), cmd.end(), "--");
+    return !cmd.empty() &&
+           cmSystemTools::GetFilenameName(cmd.front()) == "pyctest-launcher" &&
+           std::find(cmd.begin(), _sep, opt) != _sep;
+}
+//----------------------------------------------------------------------------//
+// libFuzzer targets (see pyctest.fuzz) only stop at the end of the slice of
+// time the launcher gives them, they are not run without it
+bool
+is_fuzz_target(const strvec_t& cmd)
+{
+    return has_launcher_option(cmd, "--fuzz");
+}
+//----------------------------------------------------------------------------//
+// benchmarks (see pyctest.benchmark) are timed runs of their command
+bool
+is_benchmark(const strvec_t& cmd)
+{
+    return has_launcher_option(cmd, "--repeat");
+}
+//----------------------------------------------------------------------------//
+// incremental mode: the inputs of every test are hashed and a test whose
+// inputs are identical to the ones of its last passing run is replaced by a
+// command that only reports it as a cached pass. The inputs are the command
+// line, the executable (the command of pyctest-launcher, not the launcher),
+// the arguments naming files (e.g. the script of an interpreter), the files
+// listed in the PYCTEST_INPUTS property, and the properties of the test and
+// its profile (ENVIRONMENT, ...). Tests the
+// cached command cannot stand in for (see Cacheable) always run
+class pycmIncrementalTests
+{
+public:
+    typedef std::map<string_t, string_t> hash_map_t;
+
+public:
+    pycmIncrementalTests()
+    : m_enabled(false)
+    {
+    }
+
+    // "cache_file" stores the file hashes between sessions
+    void Enable(const strvec_t& cached_command, const string_t& cache_file)
+    {
+        m_enabled        = true;
+        m_cached_command = cached_command;
+        m_cache_file     = cache_file;
+        m_files.Clear();
+        hash_map_t().swap(m_hashes);
+        hash_map_t().swap(m_pending);
+        if(!m_cache_file.empty() && cmSystemTools::FileExists(m_cache_file))
+            m_files.Read(m_cache_file);
+    }
+    // stop replacing tests, the hashes of the tests that will run are kept
+    // until Update(...)
+    void            Disable() { m_enabled = false; }
+    bool            Enabled() const { return m_enabled; }
+    const strvec_t& CachedCommand() const { return m_cached_command; }
+    size_t          NumPending() const { return m_pending.size(); }
+    // true if the test was replaced by the cached command
+    bool IsReplaced(const string_t& name) const
+    {
+        return m_hashes.count(name) > 0 && m_pending.count(name) == 0;
+    }
+
+    string_t InputHash(const pycmTest* test)
+    {
+        auto itr = m_hashes.find(test->GetName());
+        if(itr != m_hashes.end())
+            return itr->second;
+
+        std::stringstream ss;
+        strvec_t          _command = test->GetCommand();
+        for(const auto& arg : _command)
+            ss << arg << '\0';
+
+        // relative paths are relative to the working directory of the test
+        strvec_t    _args = strip_launcher(_command);
+        const char* _wdir = test->GetProperty("WORKING_DIRECTORY");
+        string_t    _base = (_wdir && *_wdir) ? string_t(_wdir) : string_t("");
+        string_t    _exe  = (_args.empty()) ? string_t("") : _args.front();
+        if(!_exe.empty() && !cmSystemTools::FileExists(_exe))
+            _exe = cmSystemTools::FindProgram(_exe);
+        ss << "exe=" << m_files.Hash(_exe) << '\0';
+        for(size_t i = 1; i < _args.size(); ++i)
+        {
+            string_t _path = (_base.empty())
+                                 ? _args.at(i)
+                                 : cmSystemTools::CollapseFullPath(_args.at(i),
+                                                                   _base);
+            if(cmSystemTools::FileExists(_path, true))
+                ss << "arg=" << i << ':' << m_files.Hash(_path) << '\0';
+        }
+
+        for(const auto& file : get_list_property(test, "PYCTEST_INPUTS"))
+            ss << "input=" << file << ':' << m_files.Hash(file) << '\0';
+
+        if(test->GetProfile())
+            for(const auto& prop : test->GetProfile()->GetProperties())
+                ss << "profile:" << *prop.first << '=' << *prop.second << '\0';
+        for(const auto& prop : test->GetProperties())
+            ss << *prop.first << '=' << *prop.second << '\0';
+
+        cmCryptoHash _sha1(cmCryptoHash::AlgoSHA1);
+        string_t     _hash        = _sha1.HashString(ss.str());
+        m_hashes[test->GetName()] = _hash;
+        return _hash;
+    }
+
+    // the cached command only prints a message and exits with zero: a test
+    // whose result is not its exit code or which sets up (or cleans up) a
+    // fixture for other tests cannot be replaced by it. Fuzz targets search
+    // further with every run and benchmarks measure the machine as well as
+    // their inputs, so they are never cached either
+    static bool Cacheable(const pycmTest* test)
+    {
+        strvec_t _command = test->GetCommand();
+        if(test->GetPropertyAsBool("WILL_FAIL") || is_fuzz_target(_command) ||
+           is_benchmark(_command))
+            return false;
+        for(const char* prop :
+            { "PASS_REGULAR_EXPRESSION", "FAIL_REGULAR_EXPRESSION",
+              "FIXTURES_SETUP", "FIXTURES_CLEANUP" })
+        {
+            const char* _val = test->GetProperty(prop);
+            if(_val && *_val)
+                return false;
+        }
+        return true;
+    }
+
+    // true if the test passed with the same inputs. Otherwise the test will
+    // run and its hash is recorded by Update(...) if it passes
+    bool IsCached(const pycmTest* test, const pycmTestHistory* history)
+    {
+        if(!Cacheable(test))
+            return false;
+
+        string_t _hash   = InputHash(test);
+        auto     _record = history->Find(test->GetName());
+        if(_record && _record->inputs == _hash)
+            return true;
+        m_pending[test->GetName()] = _hash;
+        return false;
+    }
+
+    // record the hashes of the tests that passed and save the file hashes
+    void Update(pycmTestHistory* history,
+                const pycmTestHistory::result_map_t& results)
+    {
+        for(const auto& itr : m_pending)
+        {
+            auto _result = results.find(itr.first);
+            if(_result == results.end())
+                continue;
+            history->Get(itr.first).inputs =
+                (_result->second) ? itr.second : string_t("");
+        }
+        hash_map_t().swap(m_pending);
+        if(!m_cache_file.empty() && !m_files.Write(m_cache_file))
+            std::cerr << "pycmIncrementalTests:: Error writing \""
+                      << m_cache_file << "\"!!!" << std::endl;
+    }
+
+private:
+    bool              m_enabled;
+    strvec_t          m_cached_command;
+    string_t          m_cache_file;
+    pycmFileHashCache m_files;
+    hash_map_t        m_hashes;
+    hash_map_t        m_pending;
+};
+//----------------------------------------------------------------------------//
+pycmIncrementalTests*
+get_incremental_tests()
+{
+    typedef std::shared_ptr<pycmIncrementalTests> ptr_t;
+    static ptr_t _instance = ptr_t(new pycmIncrementalTests());
+    return _instance.get();
+}
+//----------------------------------------------------------------------------//
+// RESOURCE_LOCK added to the tests the history knows to be flaky so they never
+// run concurrently with each other (empty = disabled)
+string_t&
+get_flaky_resource_lock()
+{
+    static string_t _instance = "";
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+// memory the tests running at the same time may use (MiB, 0 = disabled) and
+// the number of jobs CTest runs them with. CTest only schedules by PROCESSORS
+// so every job stands for budget / jobs of memory and a test reserves as many
+// jobs as its peak RSS needs. The peaks of the tests running together then
+// stay under the budget and a test that needs more than the budget runs alone
+double&
+get_memory_budget()
+{
+    static double _instance = 0.0;
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+long&
+get_memory_jobs()
+{
+    static long _instance = 0;
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+// TIMEOUT of the tests with enough recent run times in the history:
+// "factor" times the "quantile" of the times plus "floor" seconds, at most
+// "limit" seconds (if > 0). Disabled with a factor of zero
+struct timeout_policy_t
+{
+    timeout_policy_t()
+    : factor(0.0)
+    , quantile(0.99)
+    , floor(60.0)
+    , limit(0.0)
+    {
+    }
+
+    double factor;
+    double quantile;
+    double floor;
+    double limit;
+
+    // the recent runs a timeout is derived from
+    static size_t MinRuns() { return 3; }
+};
+//----------------------------------------------------------------------------//
+timeout_policy_t&
+get_timeout_policy()
+{
+    static timeout_policy_t _instance;
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+// "q" quantile of the values, interpolated between the closest ranks
+double
+quantile(std::vector<double> values, double q)
+{
+    if(values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    double _pos = std::min(std::max(q, 0.0), 1.0) * (values.size() - 1);
+    size_t _lo  = static_cast<size_t>(_pos);
+    size_t _hi  = std::min(_lo + 1, values.size() - 1);
+    return values[_lo] + (_pos - _lo) * (values[_hi] - values[_lo]);
+}
+//----------------------------------------------------------------------------//
+// pyctest-launcher wrapped around the command of every generated test to
+// report its CPU time, peak RSS, and I/O as measurements (empty = disabled)
+string_t&
+get_measurement_launcher()
+{
+    static string_t _instance = "";
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+// tests with the PYCTEST_METRICS property, a list of "<name>=<regex>" and
+// "<name>=json:<path>" rules (see pycmLauncher.cpp), run through the launcher,
+// which reports the values the rules extract from their output as
+// measurements and appends the numbers to the "store" (if not empty)
+struct metric_policy_t
+{
+    string_t launcher;
+    string_t store;
+};
+//----------------------------------------------------------------------------//
+metric_policy_t&
+get_metric_policy()
+{
+    static metric_policy_t _instance;
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+// tests with the PYCTEST_BATCH property (the result protocol: "gtest",
+// "catch2", or "pyctest", see pycmLauncher.cpp) whose commands only differ by
+// the last argument (the test case) and which share the working directory,
+// the environment, and the scheduling properties (FIXTURES_REQUIRED, DEPENDS,
+// RESOURCE_LOCK including the derived locks, RUN_SERIAL) are run in batches of
+// up to PYCTEST_BATCH_SIZE (default: DefaultSize()) cases by a single process.
+// Each batch is a fixture setup test with these properties, the largest
+// PROCESSORS of its cases, and the sum of their TIMEOUTs
+//
+//      pyctest-launcher --batch <protocol> --results <file> --cases <N> --
+//          <command> <case>...
+//
+// and the test of a case only reports its result from the results file
+// (pyctest-launcher --batch-result <file> -- <case>). A larger batch saves
+// more process start-ups, a smaller one runs more in parallel and re-runs
+// fewer cases one at a time when the process crashes
+class pycmTestBatches
+{
+public:
+    struct member_t
+    {
+        string_t fixture;
+        string_t results;
+        string_t arg;
+    };
+
+    typedef std::map<string_t, member_t> member_map_t;
+
+public:
+    pycmTestBatches()
+    : m_default_size(32)
+    {
+    }
+
+    // batching is disabled without a launcher
+    void SetLauncher(const string_t& val) { m_launcher = val; }
+    void SetDefaultSize(size_t val) { m_default_size = val; }
+    const string_t& Launcher() const { return m_launcher; }
+    size_t          DefaultSize() const { return m_default_size; }
+
+    // group the tests into batches whose results are written in "directory"
+    void Build(test_list_t* test_list, const test_template_list_t* templates,
+               const test_filter_t& filter, const string_t& directory);
+
+    // the batch of a test or nullptr
+    const member_t* Find(const string_t& name) const
+    {
+        auto itr = m_members.find(name);
+        return (itr == m_members.end()) ? nullptr : &itr->second;
+    }
+
+    // the setup tests of the batches
+    test_list_t* Tests() { return &m_tests; }
+
+    void Clear()
+    {
+        test_list_t().swap(m_tests);
+        member_map_t().swap(m_members);
+        m_arena.Clear();
+    }
+
+private:
+    string_t      m_launcher;
+    size_t        m_default_size;
+    pycmTestArena m_arena;
+    test_list_t   m_tests;
+    member_map_t  m_members;
+};
+//----------------------------------------------------------------------------//
+pycmTestBatches*
+get_test_batches()
+{
+    typedef std::shared_ptr<pycmTestBatches> ptr_t;
+    static ptr_t _instance = ptr_t(new pycmTestBatches());
+    return _instance.get();
+}
+//----------------------------------------------------------------------------//
+// at most Limit(label) tests with a label run at the same time. CTest only
+// knows RESOURCE_LOCK, which admits one test at a time, so the tests of a
+// label limited to N are spread over N locks ("pyctest-<label>-<k>") by their
+// COST, longest first to the least loaded lock. No two tests holding the same
+// lock run together, hence at most N do. The assignment is fixed when the
+// test file is generated: a lock whose tests finish early leaves its share of
+// the limit unused, which the balancing keeps small
+class pycmLabelLimits
+{
+public:
+    typedef std::map<string_t, size_t>   limit_map_t;
+    typedef std::map<string_t, strvec_t> lock_map_t;
+
+public:
+    // a limit of zero removes the limit of the label
+    void SetLimit(const string_t& label, size_t val)
+    {
+        if(val == 0)
+            m_limits.erase(label);
+        else
+            m_limits[label] = val;
+    }
+    const limit_map_t& Limits() const { return m_limits; }
+
+    // assign the locks of the limited labels to the tests. With "all" the
+    // locks are assigned even if a label has no more tests than locks
+    // because more tests follow (see Assign)
+    void Build(test_list_t* test_list, const test_template_list_t* templates,
+               const test_filter_t& filter, bool all = false);
+
+    // the locks of a test that was not known to Build (e.g. a test of a
+    // source): the least loaded lock of each of its limited labels
+    strvec_t Assign(const pycmTest* test);
+
+    // the locks of a test or nullptr
+    const strvec_t* Find(const string_t& name) const
+    {
+        auto itr = m_locks.find(name);
+        return (itr == m_locks.end()) ? nullptr : &itr->second;
+    }
+
+    void Clear()
+    {
+        lock_map_t().swap(m_locks);
+        load_map_t().swap(m_loads);
+    }
+
+private:
+    typedef std::map<string_t, std::vector<double>> load_map_t;
+
+    // COST of the test, the cost in the history, or 1
+    static double   Cost(const pycmTest* test);
+    static string_t Prefix(const string_t& label)
+    {
+        return sanitize_test_name("pyctest-" + label) + "-";
+    }
+
+private:
+    limit_map_t m_limits;
+    lock_map_t  m_locks;
+    load_map_t  m_loads;  // load of the locks of each label
+};
+//----------------------------------------------------------------------------//
+pycmLabelLimits*
+get_label_limits()
+{
+    typedef std::shared_ptr<pycmLabelLimits> ptr_t;
+    static ptr_t _instance = ptr_t(new pycmLabelLimits());
+    return _instance.get();
+}
+//----------------------------------------------------------------------------//
+// scheduling properties derived from the test history. Properties set on the
+// test (or its profile) are never overridden. COST makes CTest start the
+// longest tests first; PROCESSORS is only suggested when the history has a
+// CPU time, i.e. the test is known to use more than one core, or a peak RSS
+// that needs more than one job of the memory budget. TIMEOUT follows the
+// timeout policy. Known flaky tests are added to the flaky resource lock and
+// the tests with a limited label to the locks of the label
+strpair_list_t
+derive_test_properties(const pycmTest* test)
+{
+    strpair_list_t _props;
+    strvec_t       _locks;
+    auto           _record = get_test_history()->Find(test->GetName());
+    auto           _labels = get_label_limits()->Find(test->GetName());
+    if(_labels)
+        _locks = *_labels;
+    if(!_record && _locks.empty())
+        return _props;
+
+    auto to_string = [](double val) {
+        std::stringstream ss;
+        ss << std::setprecision(6) << val;
+        return ss.str();
+    };
+
+    if(_record && _record->cost > 0.0 && !test->GetProperty("COST"))
+        _props.push_back(strpair_t("COST", to_string(_record->cost)));
+
+    if(_record && !test->GetProperty("PROCESSORS"))
+    {
+        long _nproc = 1;
+        if(_record->cost > 0.0 && _record->cpu > 0.0)
+        {
+            long _nmax = std::max<long>(std::thread::hardware_concurrency(), 1);
+            _nproc     = std::lround(_record->cpu / _record->cost);
+            _nproc     = std::min(std::max(_nproc, 1L), _nmax);
+        }
+
+        double _budget = get_memory_budget();
+        long   _jobs   = get_memory_jobs();
+        if(_budget > 0.0 && _jobs > 0 && _record->memory > 0.0)
+        {
+            // jobs of the budget the peak RSS needs
+            long _nmem = std::lround(std::ceil(_record->memory * _jobs /
+                                               _budget));
+            _nproc     = std::max(_nproc, std::min(_nmem, _jobs));
+        }
+
+        if(_nproc > 1)
+            _props.push_back(strpair_t("PROCESSORS", std::to_string(_nproc)));
+    }
+
+    const timeout_policy_t& _policy = get_timeout_policy();
+    if(_record && _policy.factor > 0.0 &&
+       _record->times.size() >= timeout_policy_t::MinRuns() &&
+       !test->GetProperty("TIMEOUT"))
+    {
+        double _timeout = _policy.factor * quantile(_record->times,
+                                                    _policy.quantile) +
+                          _policy.floor;
+        if(_policy.limit > 0.0)
+            _timeout = std::min(_timeout, _policy.limit);
+        _props.push_back(strpair_t(
+            "TIMEOUT", std::to_string(std::lround(std::ceil(_timeout)))));
+    }
+
+    const string_t& _lock = get_flaky_resource_lock();
+    if(_record && !_lock.empty() && _record->IsFlaky())
+        _locks.push_back(_lock);
+
+    if(!_locks.empty())
+    {
+        const char* _val = test->GetProperty("RESOURCE_LOCK");
+        string_t    _all = (_val) ? string_t(_val) : string_t("");
+        for(const auto& itr : _locks)
+            _all += (_all.empty()) ? itr : ";" + itr;
+        _props.push_back(strpair_t("RESOURCE_LOCK", _all));
+    }
+    return _props;
+}
+//----------------------------------------------------------------------------//
+// set up the generator of a test: the derived properties, the measurement
+// launcher, the report of the result of a test run in a batch and, in
+// incremental mode, the replacement of the tests whose inputs did not change.
+// The "streamed" tests (see write_streamed_tests) are never replaced: the
+// hashes of their inputs would be kept for every one of them
+void
+configure_generator(pycmTestGenerator& generator, pycmTest* test,
+                    bool streamed = false)
+{
+    auto _incremental = get_incremental_tests();
+    if(!streamed && _incremental->Enabled() &&
+       _incremental->IsCached(test, get_test_history()))
+    {
+        const char* _labels = test->GetProperty("LABELS");
+        string_t    _cached = (_labels && *_labels)
+                               ? string_t(_labels) + ";cached"
+                               : string_t("cached");
+        generator.SetCommand(_incremental->CachedCommand());
+        generator.SetDerivedProperties({ strpair_t("LABELS", _cached) });
+        return;
+    }
+
+    auto _batches = get_test_batches();
+    auto _member  = _batches->Find(test->GetName());
+    if(_member)
+    {
+        strpair_list_t _props    = derive_test_properties(test);
+        const char*    _fixtures = test->GetProperty("FIXTURES_REQUIRED");
+        _props.push_back(strpair_t("FIXTURES_REQUIRED",
+                                   (_fixtures && *_fixtures)
+                                       ? string_t(_fixtures) + ";" +
+                                             _member->fixture
+                                       : _member->fixture));
+        if(!test->GetProperty("SKIP_RETURN_CODE"))
+            _props.push_back(strpair_t("SKIP_RETURN_CODE", "77"));
+        generator.SetCommand({ _batches->Launcher(), "--batch-result",
+                               _member->results, "--", _member->arg });
+        generator.SetDerivedProperties(_props);
+        return;
+    }
+    generator.SetDerivedProperties(derive_test_properties(test));
+
+    const auto& _metrics  = get_metric_policy();
+    string_t    _launcher = get_measurement_launcher();
+    strvec_t    _command  = test->GetCommand();
+    strvec_t    _rules    = get_list_property(test, "PYCTEST_METRICS");
+    // only the metrics unless the resources are measured too
+    bool _resources = !_launcher.empty();
+    if(!_rules.empty())
+        _launcher = _metrics.launcher;
+    // benchmarks, fuzz targets, and the tests of the pool already run
+    // through the launcher, which does not extract metrics for them
+    bool _launched = !_command.empty() &&
+                     cmSystemTools::GetFilenameName(_command.front()) ==
+                         "pyctest-launcher";
+    if(!_rules.empty() && _launched)
+        std::cerr << __FUNCTION__ << ":: Warning! The PYCTEST_METRICS of \""
+                  << test->GetName() << "\" are ignored: it already runs "
+                  << "through pyctest-launcher" << std::endl;
+    if(!_launcher.empty() && !_command.empty() && !_launched)
+    {
+        strvec_t _options = { _launcher };
+        if(!_resources)
+            _options.push_back("--no-resources");
+        for(const auto& itr : _rules)
+            _options.insert(_options.end(), { "--metric", itr });
+        if(!_rules.empty() && !_metrics.store.empty())
+            _options.insert(_options.end(), { "--metric-store", _metrics.store,
+                                              "--name", test->GetName() });
+        _options.push_back("--");
+        _command.insert(_command.begin(), _options.begin(), _options.end());
+        generator.SetCommand(_command);
+    }
+}
+//----------------------------------------------------------------------------//
+// visit the registered tests followed by every expansion of the templates.
+// Template expansions are streamed through a single scratch test (with its
+// own string pool) so they are never materialized
+void
+for_each_test(test_list_t* test_list, const test_template_list_t* templates,
+              const std::function<void(pycmTest*)>& _func,
+              const test_filter_t&                  _filter = test_filter_t())
+{
+    if(test_list)
+        for(auto itr : *test_list)
+            if(!_filter || _filter(itr))
+                _func(itr);
+
+    if(!templates)
+        return;
+
+    pycmStringPool _strings;
+    for(const auto& itr : *templates)
+    {
+        for(size_t i = 0; i < itr.Size(); ++i)
+        {
+            _strings.Clear();
+            pycmTest _test(&_strings);
+            itr.Expand(i, &_test);
+            if(!_filter || _filter(&_test))
+                _func(&_test);
+        }
+    }
+}
+//----------------------------------------------------------------------------//
+size_t
+count_tests(test_list_t* test_list, const test_template_list_t* templates)
+{
+    size_t _n = (test_list) ? test_list->size() : 0;
+    if(templates)
+        for(const auto& itr : *templates)
+            _n += itr.Size();
+    return _n;
+}
+//----------------------------------------------------------------------------//
+//
+//  Affected-test selection
+//
+//----------------------------------------------------------------------------//
+// regular expression matching the whole path for a glob: "**/" matches any
+// number of directories, "*" and "?" do not match "/"
+string_t
+glob_to_regex(const string_t& glob)
+{
+    string_t _regex = "^";
+    for(size_t i = 0; i < glob.length(); ++i)
+    {
+        char c = glob[i];
+        if(c == '*' && i + 1 < glob.length() && glob[i + 1] == '*')
+        {
+            bool _dir = (i + 2 < glob.length() && glob[i + 2] == '/');
+            _regex += (_dir) ? "(.*/)?" : ".*";
+            i += (_dir) ? 2 : 1;
+        }
+        else if(c == '*')
+            _regex += "[^/]*";
+        else if(c == '?')
+            _regex += "[^/]";
+        else if(strchr("\\^$.|+()[]{}", c))
+            _regex += string_t("\\") + c;
+        else
+            _regex += c;
+    }
+    return _regex + "$";
+}
+//----------------------------------------------------------------------------//
+// files changed between "base" and "head" (or the working tree if "head" is
+// empty) as absolute paths, using "git diff --name-only". Returns false if
+// git fails
+bool
+git_changed_files(const string_t& source_dir, const string_t& base,
+                  const string_t& head, strvec_t& files)
+{
+    string_t _top;
+    if(!capture_output({ "git", "-C", source_dir, "rev-parse",
+                         "--show-toplevel" },
+                       _top))
+        return false;
+    while(!_top.empty() && isspace(_top.back()))
+        _top.pop_back();
+
+    strvec_t _cmd = { "git", "-C", source_dir, "diff", "--name-only",
+                      "--no-renames", base };
+    if(!head.empty())
+        _cmd.push_back(head);
+
+    string_t _output;
+    if(!capture_output(_cmd, _output))
+        return false;
+    for(const auto& itr : split_lines(_output))
+        if(!itr.empty())
+            files.push_back(_top + "/" + itr);
+    return true;
+}
+//----------------------------------------------------------------------------//
+// select the tests affected by a set of changed files. The files of a test
+// are given by:
+//
+//  - the globs in its PYCTEST_SOURCES property
+//  - the globs associated with its LABELS (see AddLabelSources)
+//  - a coverage map: lines of "<test name>\t<file>"
+//
+// Relative globs and files are relative to the source directory. Tests
+// without any files are always selected and, unless the fallback is
+// disabled, every test is selected when a changed file is not associated
+// with any test
+class pycmTestSelection
+{
+public:
+    typedef std::map<string_t, strvec_t>           glob_map_t;
+    typedef std::map<string_t, std::set<string_t>> coverage_map_t;
+
+public:
+    pycmTestSelection()
+    : m_enabled(false)
+    , m_fallback(true)
+    {
+    }
+
+    bool Enabled() const { return m_enabled; }
+    void Disable() { m_enabled = false; }
+    void SetFallback(bool val) { m_fallback = val; }
+    void SetSourceDirectory(const string_t& val) { m_source_dir = val; }
+    void SetChangedFiles(const strvec_t& val)
+    {
+        m_changed = val;
+        m_enabled = true;
+    }
+    const strvec_t& GetChangedFiles() const { return m_changed; }
+
+    void AddLabelSources(const string_t& label, const strvec_t& globs)
+    {
+        auto& _globs = m_label_sources[label];
+        _globs.insert(_globs.end(), globs.begin(), globs.end());
+    }
+
+    bool ReadCoverageMap(const string_t& fname)
+    {
+        std::ifstream ifs(fname.c_str());
+        if(!ifs)
+            return false;
+        string_t _line;
+        while(std::getline(ifs, _line))
+        {
+            if(!_line.empty() && _line.back() == '\r')
+                _line.pop_back();
+            auto _tab = _line.find('\t');
+            if(_line.empty() || _line[0] == '#' || _line.find('\t') == 0 ||
+               _tab == string_t::npos)
+                continue;
+            m_coverage[_line.substr(0, _tab)].insert(
+                Absolute(_line.substr(_tab + 1)));
+        }
+        return true;
+    }
+
+    // the affected tests and the tests they need: the setup and cleanup
+    // tests of their FIXTURES_REQUIRED and the tests in their DEPENDS (and
+    // the tests those need in turn), without which CTest would run them
+    // without their setup
+    std::set<string_t> Select(test_list_t*                test_list,
+                              const test_template_list_t* templates,
+                              bool                        verbose = true)
+    {
+        typedef std::map<string_t, strvec_t> name_map_t;
+
+        std::set<string_t> _all;
+        std::set<string_t> _selected;
+        std::set<size_t>   _mapped;
+        size_t             _unknown = 0;
+        name_map_t         _requires;   // test -> FIXTURES_REQUIRED
+        name_map_t         _depends;    // test -> DEPENDS
+        name_map_t         _providers;  // fixture -> setup and cleanup tests
+
+        for_each_test(test_list, templates, [&](pycmTest* itr) {
+            string_t _name = itr->GetName();
+            _all.insert(_name);
+
+            strvec_t _fixtures = get_list_property(itr, "FIXTURES_REQUIRED");
+            strvec_t _tests    = get_list_property(itr, "DEPENDS");
+            if(!_fixtures.empty())
+                _requires[_name] = _fixtures;
+            if(!_tests.empty())
+                _depends[_name] = _tests;
+            for(const char* prop : { "FIXTURES_SETUP", "FIXTURES_CLEANUP" })
+                for(const auto& fix : get_list_property(itr, prop))
+                    _providers[fix].push_back(_name);
+
+            strvec_t _globs = get_list_property(itr, "PYCTEST_SOURCES");
+            for(const auto& label : get_list_property(itr, "LABELS"))
+            {
+                auto _label = m_label_sources.find(label);
+                if(_label != m_label_sources.end())
+                    _globs.insert(_globs.end(), _label->second.begin(),
+                                  _label->second.end());
+            }
+            auto _covered = m_coverage.find(_name);
+
+            if(_globs.empty() && _covered == m_coverage.end())
+            {
+                ++_unknown;
+                _selected.insert(_name);
+                return;
+            }
+
+            for(size_t i = 0; i < m_changed.size(); ++i)
+            {
+                bool _match = (_covered != m_coverage.end() &&
+                               _covered->second.count(m_changed[i]) > 0);
+                for(size_t j = 0; !_match && j < _globs.size(); ++j)
+                    _match = Regex(_globs[j]).find(m_changed[i]);
+                if(_match)
+                {
+                    _selected.insert(_name);
+                    _mapped.insert(i);
+                }
+            }
+        });
+
+        if(verbose)
+        {
+            std::cout << "Affected tests: " << _selected.size() << " of "
+                      << _all.size() << " (" << m_changed.size()
+                      << " changed files, " << _unknown
+                      << " tests without source files)" << std::endl;
+        }
+
+        if(m_fallback && _mapped.size() < m_changed.size())
+        {
+            for(size_t i = 0; i < m_changed.size(); ++i)
+            {
+                if(_mapped.count(i) > 0)
+                    continue;
+                if(verbose)
+                    std::cout << "  \"" << m_changed[i]
+                              << "\" is not associated with any test, "
+                              << "selecting every test" << std::endl;
+                break;
+            }
+            return _all;
+        }
+
+        size_t                _affected = _selected.size();
+        std::vector<string_t> _queue(_selected.begin(), _selected.end());
+        auto                  _add = [&](const string_t& name) {
+            if(_all.count(name) > 0 && _selected.insert(name).second)
+                _queue.push_back(name);
+        };
+        while(!_queue.empty())
+        {
+            string_t _name = _queue.back();
+            _queue.pop_back();
+            auto _dep = _depends.find(_name);
+            if(_dep != _depends.end())
+                for(const auto& itr : _dep->second)
+                    _add(itr);
+            auto _req = _requires.find(_name);
+            if(_req == _requires.end())
+                continue;
+            for(const auto& fix : _req->second)
+            {
+                auto _prov = _providers.find(fix);
+                if(_prov != _providers.end())
+                    for(const auto& itr : _prov->second)
+                        _add(itr);
+            }
+        }
+
+        if(verbose && _selected.size() > _affected)
+            std::cout << "Tests required by the affected tests: "
+                      << (_selected.size() - _affected) << std::endl;
+        return _selected;
+    }
+
+private:
+    string_t Absolute(const string_t& path) const
+    {
+        if(m_source_dir.empty() || cmSystemTools::FileIsFullPath(path))
+            return path;
+        return m_source_dir + "/" + path;
+    }
+
+    cmsys::RegularExpression& Regex(const string_t& glob)
+    {
+        auto itr = m_regex.find(glob);
+        if(itr == m_regex.end())
+            itr = m_regex
+                      .insert(std::make_pair(glob, cmsys::RegularExpression(
+                                                       glob_to_regex(
+                                                           Absolute(glob)))))
+                      .first;
+        return itr->second;
+    }
+
+private:
+    bool                                       m_enabled;
+    bool                                       m_fallback;
+    string_t                                   m_source_dir;
+    strvec_t                                   m_changed;
+    glob_map_t                                 m_label_sources;
+    coverage_map_t                             m_coverage;
+    std::map<string_t, cmsys::RegularExpression> m_regex;
+};
+//----------------------------------------------------------------------------//
+pycmTestSelection*
+get_test_selection()
+{
+    typedef std::shared_ptr<pycmTestSelection> ptr_t;
+    static ptr_t _instance = ptr_t(new pycmTestSelection());
+    return _instance.get();
+}
+//----------------------------------------------------------------------------//
+// expected run time of a test: the history, then the COST property, then
+// "default_cost" if neither is known
+double
+estimate_test_cost(const pycmTest* test, double default_cost = 1.0)
+{
+    auto _record = get_test_history()->Find(test->GetName());
+    if(_record && _record->cost > 0.0)
+        return _record->cost;
+    const char* _cost = test->GetProperty("COST");
+    if(_cost && std::atof(_cost) > 0.0)
+        return std::atof(_cost);
+    return default_cost;
+}
+//----------------------------------------------------------------------------//
+// visit the tests (see for_each_test) and group the ones sharing a fixture,
+// CTest needs the setup and cleanup tests in the same run. Returns the indices
+// (in visiting order) of the tests of each group and sets "costs" to the
+// expected run time of each test, the mean of the known costs if unknown
+std::vector<std::vector<size_t>>
+group_tests(test_list_t* test_list, const test_template_list_t* templates,
+            std::vector<double>&                  costs,
+            const std::function<void(pycmTest*)>& _func,
+            const test_filter_t&                  _filter = test_filter_t())
+{
+    std::vector<size_t>        _parent;
+    std::map<string_t, size_t> _fixtures;
+    double                     _known  = 0.0;
+    size_t                     _nknown = 0;
+
+    auto _root = [&_parent](size_t i) {
+        while(_parent[i] != i)
+            i = _parent[i] = _parent[_parent[i]];
+        return i;
+    };
+
+    costs.clear();
+    for_each_test(test_list, templates, [&](pycmTest* itr) {
+        double _cost = estimate_test_cost(itr, 0.0);
+        if(_cost > 0.0)
+        {
+            _known += _cost;
+            ++_nknown;
+        }
+        size_t _idx = costs.size();
+        costs.push_back(_cost);
+        _parent.push_back(_idx);
+        _func(itr);
+
+        for(const char* prop :
+            { "FIXTURES_SETUP", "FIXTURES_REQUIRED", "FIXTURES_CLEANUP" })
+        {
+            for(const auto& fix : get_list_property(itr, prop))
+            {
+                auto _fix = _fixtures.insert(std::make_pair(fix, _idx));
+                if(!_fix.second)
+                    _parent[_root(_idx)] = _root(_fix.first->second);
+            }
+        }
+    }, _filter);
+
+    double _default = (_nknown > 0) ? (_known / _nknown) : 1.0;
+    for(auto& itr : costs)
+        if(itr <= 0.0)
+            itr = _default;
+
+    std::map<size_t, std::vector<size_t>> _groups;
+    for(size_t i = 0; i < costs.size(); ++i)
+        _groups[_root(i)].push_back(i);
+
+    std::vector<std::vector<size_t>> _result;
+    for(auto& itr : _groups)
+        _result.push_back(std::move(itr.second));
+    return _result;
+}
+//----------------------------------------------------------------------------//
+// names of the tests in shard "index" of "count". Tests sharing a fixture are
+// kept together (CTest needs the setup and cleanup tests in the same run).
+// Groups are assigned longest-first to the least loaded shard and ties are
+// broken by name, so the split only depends on the test names and the costs.
+// Tests without a known cost are assumed to take the mean of the known costs
+std::set<string_t>
+shard_tests(test_list_t* test_list, const test_template_list_t* templates,
+            size_t index, size_t count, bool verbose = false,
+            const test_filter_t& filter = test_filter_t())
+{
+    if(index >= count)
+        throw std::runtime_error("shard_tests: the shard index must be less "
+                                 "than the number of shards");
+
+    strvec_t            _tests;
+    std::vector<double> _costs;
+    auto                _groups = group_tests(
+        test_list, templates, _costs,
+        [&](pycmTest* itr) { _tests.push_back(itr->GetName()); }, filter);
+
+    std::vector<std::pair<double, strvec_t>> _sorted;
+    for(const auto& itr : _groups)
+    {
+        std::pair<double, strvec_t> _group(0.0, strvec_t());
+        for(auto i : itr)
+        {
+            _group.first += _costs[i];
+            _group.second.push_back(_tests[i]);
+        }
+        std::sort(_group.second.begin(), _group.second.end());
+        _sorted.push_back(_group);
+    }
+    std::sort(_sorted.begin(), _sorted.end(),
+              [](const std::pair<double, strvec_t>& lhs,
+                 const std::pair<double, strvec_t>& rhs) {
+                  if(lhs.first != rhs.first)
+                      return lhs.first > rhs.first;
+                  return lhs.second.front() < rhs.second.front();
+              });
+
+    std::vector<double> _load(std::max<size_t>(count, 1), 0.0);
+    std::set<string_t>  _shard;
+    for(const auto& itr : _sorted)
+    {
+        size_t _min = std::min_element(_load.begin(), _load.end()) -
+                      _load.begin();
+        _load[_min] += itr.first;
+        if(_min == index)
+            _shard.insert(itr.second.begin(), itr.second.end());
+    }
+
+    if(verbose)
+    {
+        double _total = 0.0;
+        for(auto itr : _load)
+            _total += itr;
+        std::cout << "Shard " << index << " of " << count << ": "
+                  << _shard.size() << " of " << _tests.size()
+                  << " tests, expected time " << _load.at(index) << " of "
+                  << _total << " seconds" << std::endl;
+    }
+    return _shard;
+}
+//----------------------------------------------------------------------------//
+// probability that a run of the test fails, estimated from the history with
+// one pass and one failure added (so an unknown test is a coin flip). Runs a
+// re-run rescued are not counted as failures, a failure of the last run
+// makes the test at least as likely to fail as an unknown test
+double
+estimate_failure_rate(const pycmTest* test)
+{
+    auto _record = get_test_history()->Find(test->GetName());
+    if(!_record)
+        return 0.5;
+    double _fails = static_cast<double>(_record->runs - _record->passes) -
+                    static_cast<double>(_record->flaky);
+    double _rate  = (std::max(_fails, 0.0) + 1.0) / (_record->runs + 2.0);
+    return (_record->failed) ? std::max(_rate, 0.5) : _rate;
+}
+//----------------------------------------------------------------------------//
+// names of the tests to run within "budget" seconds on "jobs" jobs, chosen to
+// maximize the expected number of failures caught. As in shard_tests, tests
+// sharing a fixture are one group. The groups with the most expected
+// failures per CPU-second (cost x PROCESSORS) are taken first while they fit
+// in budget x jobs and no test is longer than the budget. The groups with the
+// least expected failures per CPU-second are then dropped until a
+// longest-first schedule of the tests on the jobs finishes within the budget
+std::set<string_t>
+plan_tests(test_list_t* test_list, const test_template_list_t* templates,
+           double budget, size_t jobs, bool verbose = false,
+           const test_filter_t& filter = test_filter_t())
+{
+    struct entry_t
+    {
+        string_t name;
+        double   cost;
+        double   procs;
+        double   value;
+    };
+
+    struct group_t
+    {
+        group_t()
+        : area(0.0)
+        , length(0.0)
+        , value(0.0)
+        {
+        }
+
+        double               area;
+        double               length;
+        double               value;
+        std::vector<entry_t> tests;
+    };
+
+    jobs = std::max<size_t>(jobs, 1);
+
+    std::vector<entry_t> _tests;
+    std::vector<double>  _costs;
+    auto                 _groups = group_tests(
+        test_list, templates, _costs,
+        [&](pycmTest* itr) {
+            const char* _procs = itr->GetProperty("PROCESSORS");
+            _tests.push_back(
+                { itr->GetName(), 0.0,
+                  (_procs) ? std::max(std::atof(_procs), 1.0) : 1.0,
+                  estimate_failure_rate(itr) });
+        },
+        filter);
+
+    std::vector<group_t> _sorted;
+    double               _total = 0.0;
+    double               _risk  = 0.0;
+    for(const auto& itr : _groups)
+    {
+        group_t _group;
+        for(auto i : itr)
+        {
+            auto& _test = _tests[i];
+            _test.cost  = _costs[i];
+            _group.area += _test.cost * std::min<double>(_test.procs, jobs);
+            _group.length = std::max(_group.length, _test.cost);
+            _group.value += _test.value;
+            _group.tests.push_back(_test);
+            _total += _test.cost;
+            _risk += _test.value;
+        }
+        std::sort(_group.tests.begin(), _group.tests.end(),
+                  [](const entry_t& lhs, const entry_t& rhs) {
+                      return lhs.name < rhs.name;
+                  });
+        _sorted.push_back(_group);
+    }
+    std::sort(_sorted.begin(), _sorted.end(),
+              [](const group_t& lhs, const group_t& rhs) {
+                  double _lhs = lhs.value / lhs.area;
+                  double _rhs = rhs.value / rhs.area;
+                  if(_lhs != _rhs)
+                      return _lhs > _rhs;
+                  return lhs.tests.front().name < rhs.tests.front().name;
+              });
+
+    std::vector<const group_t*> _chosen;
+    double                      _area = 0.0;
+    for(const auto& itr : _sorted)
+    {
+        if(itr.length > budget || _area + itr.area > budget * jobs)
+            continue;
+        _area += itr.area;
+        _chosen.push_back(&itr);
+    }
+
+    // longest-first schedule of the chosen tests on the jobs
+    auto _makespan = [&]() {
+        std::vector<const entry_t*> _entries;
+        for(auto itr : _chosen)
+            for(const auto& test : itr->tests)
+                _entries.push_back(&test);
+        std::sort(_entries.begin(), _entries.end(),
+                  [](const entry_t* lhs, const entry_t* rhs) {
+                      return lhs->cost > rhs->cost;
+                  });
+        std::vector<double> _load(jobs, 0.0);
+        for(auto itr : _entries)
+        {
+            // a test using more than one job occupies the least loaded ones
+            std::sort(_load.begin(), _load.end());
+            size_t _n     = std::min<size_t>(std::lround(itr->procs), jobs);
+            double _start = _load.at(std::max<size_t>(_n, 1) - 1);
+            for(size_t i = 0; i < std::max<size_t>(_n, 1); ++i)
+                _load.at(i) = _start + itr->cost;
+        }
+        return *std::max_element(_load.begin(), _load.end());
+    };
+
+    while(!_chosen.empty() && _makespan() > budget)
+        _chosen.pop_back();
+
+    std::set<string_t> _plan;
+    double             _time   = 0.0;
+    double             _caught = 0.0;
+    for(auto itr : _chosen)
+    {
+        _caught += itr->value;
+        for(const auto& test : itr->tests)
+        {
+            _plan.insert(test.name);
+            _time += test.cost;
+        }
+    }
+
+    if(verbose)
+    {
+        std::cout << "Time budget of " << budget << " seconds on " << jobs
+                  << " jobs: " << _plan.size() << " of " << _tests.size()
+                  << " tests, " << _time << " of " << _total
+                  << " test-seconds, expected failures caught " << _caught
+                  << " of " << _risk << std::endl;
+    }
+    return _plan;
+}
+//----------------------------------------------------------------------------//
+void
+write_test_file(const string_t& fname, test_list_t* test_list,
+                const test_template_list_t* templates = nullptr,
+                bool                        verbose   = true,
+                const test_filter_t&        filter    = test_filter_t())
+{
+    std::ofstream ofs(fname.c_str());
+    if(!ofs)
+    {
+        std::cerr << __FUNCTION__ << ":: Error opening " << fname << "!!!"
+                  << std::endl;
+        return;
+    }
+
+    std::cout << "Writing CTest test file: \"" << fname << "\"..."
+              << std::endl;
+
+    // add all the tests first: the shared profile properties are set with
+    // one set_tests_properties(...) per profile and the properties set on
+    // the individual tests must come after them in order to take precedence.
+    // The template expansions are not collected: each one is followed by the
+    // properties of its profile (as in write_streamed_tests)
+    strvec_t                             configs(0, "");
+    std::vector<pycmTestProfile*>        profiles;
+    std::map<pycmTestProfile*, strvec_t> profile_tests;
+    auto                                 generate = [&](pycmTest* itr) {
+        pycmTestGenerator _generator(itr);
+        if(verbose)
+            std::cout << "Generating test \"" << itr->GetName() << "\"..."
+                      << std::endl;
+        configure_generator(_generator, itr);
+        _generator.SetDeferProperties(true);
+        _generator.Generate(ofs, "", configs);
+    };
+
+    for_each_test(test_list, nullptr, [&](pycmTest* itr) {
+        generate(itr);
+        auto _profile = itr->GetProfile();
+        if(_profile)
+        {
+            if(profile_tests.find(_profile) == profile_tests.end())
+                profiles.push_back(_profile);
+            profile_tests[_profile].push_back(itr->GetName());
+        }
+    }, filter);
+
+    for_each_test(nullptr, templates, [&](pycmTest* itr) {
+        generate(itr);
+        auto _profile = itr->GetProfile();
+        if(!_profile || _profile->GetProperties().empty())
+            return;
+        ofs << "set_tests_properties(" << itr->GetName() << " PROPERTIES ";
+        for(auto const& i : _profile->GetProperties())
+            ofs << " " << *i.first << " "
+                << cmOutputConverter::EscapeForCMake(*i.second);
+        ofs << ")\n";
+    }, filter);
+
+    for(auto itr : profiles)
+    {
+        const pycmPropertyList& pm = itr->GetProperties();
+        if(pm.empty())
+            continue;
+        ofs << "set_tests_properties(";
+        for(const auto& name : profile_tests[itr])
+            ofs << name << " ";
+        ofs << "PROPERTIES ";
+        for(auto const& i : pm)
+            ofs << " " << *i.first << " "
+                << cmOutputConverter::EscapeForCMake(*i.second);
+        ofs << ")" << std::endl;
+    }
+
+    // template expansions are deterministic so they are expanded again
+    // instead of being kept around for this pass
+    for_each_test(test_list, templates, [&](pycmTest* itr) {
+        pycmTestGenerator _generator(itr);
+        configure_generator(_generator, itr);
+        _generator.GenerateProperties(ofs);
+    }, filter);
+}
+//----------------------------------------------------------------------------//
+void
+write_test_manifest(const string_t& fname, test_list_t* test_list,
+                    const test_template_list_t* templates = nullptr,
+                    const test_filter_t&        filter    = test_filter_t())
+{
+    std::ofstream ofs(fname.c_str(),
+                      std::ios_base::out | std::ios_base::binary);
+    if(!ofs)
+    {
+        std::cerr << __FUNCTION__ << ":: Error opening " << fname << "!!!"
+                  << std::endl;
+        return;
+    }
+
+    std::cout << "Writing CTest test manifest: \"" << fname << "\"..."
+              << std::endl;
+    ofs << get_manifest_header() << '\n';
+
+    std::set<pycmTestProfile*>    profiles;
+    std::vector<pycmTestProfile*> _used;
+    for(auto itr : *test_list)
+        _used.push_back(itr->GetProfile());
+    if(templates)
+        for(const auto& itr : *templates)
+            _used.push_back(itr.GetProfile());
+
+    for(auto _profile : _used)
+        if(_profile && profiles.insert(_profile).second)
+            manifest_write_profile(ofs, _profile);
+
+    for_each_test(test_list, templates, [&](pycmTest* itr) {
+        manifest_write_test(ofs, itr);
+    }, filter);
+}
+//----------------------------------------------------------------------------//
+// append the tests of "source" to the test file and, if "mname" is not empty,
+// to the manifest as they are produced. Every test is generated into the same
+// scratch test (with its own string pool) and written with the properties of
+// its profile followed by its own, so none of them is kept. The tests with a
+// limited label take the locks of the label (see pycmLabelLimits::Assign).
+// They always run, even in incremental mode. Returns the number of tests
+// written
+size_t
+write_streamed_tests(const string_t& fname, const string_t& mname,
+                     const test_source_t& source, bool verbose = false)
+{
+    std::ofstream ofs(fname.c_str(), std::ios_base::app);
+    if(!ofs)
+    {
+        std::cerr << __FUNCTION__ << ":: Error opening " << fname << "!!!"
+                  << std::endl;
+        return 0;
+    }
+    std::ofstream mfs;
+    if(!mname.empty())
+    {
+        mfs.open(mname.c_str(), std::ios_base::app | std::ios_base::binary);
+        if(!mfs)
+        {
+            std::cerr << __FUNCTION__ << ":: Error opening " << mname
+                      << "!!!" << std::endl;
+            return 0;
+        }
+    }
+
+    std::cout << "Streaming tests to: \"" << fname << "\"..." << std::endl;
+
+    strvec_t                   configs(0, "");
+    std::set<pycmTestProfile*> profiles;  // profiles written to the manifest
+    pycmStringPool             _strings;
+    size_t                     _count  = 0;
+    auto                       _limits = get_label_limits();
+    while(true)
+    {
+        _strings.Clear();
+        pycmTest _test(&_strings);
+        if(!source(&_test))
+            break;
+
+        auto _profile = _test.GetProfile();
+        if(mfs.is_open())
+        {
+            if(_profile && profiles.insert(_profile).second)
+                manifest_write_profile(mfs, _profile);
+            manifest_write_test(mfs, &_test);
+        }
+
+        strvec_t _locks = _limits->Assign(&_test);
+        if(!_locks.empty())
+        {
+            const char* _val = _test.GetProperty("RESOURCE_LOCK");
+            string_t    _all = (_val) ? string_t(_val) : string_t("");
+            for(const auto& itr : _locks)
+                _all += (_all.empty()) ? itr : ";" + itr;
+            _test.SetProperty("RESOURCE_LOCK", _all.c_str());
+        }
+
+        if(verbose)
+            std::cout << "Generating test \"" << _test.GetName() << "\"..."
+                      << std::endl;
+        pycmTestGenerator _generator(&_test);
+        configure_generator(_generator, &_test, true);
+        _generator.SetDeferProperties(true);
+        _generator.Generate(ofs, "", configs);
+
+        if(_profile && !_profile->GetProperties().empty())
+        {
+            ofs << "set_tests_properties(" << _test.GetName() << " PROPERTIES ";
+            for(auto const& i : _profile->GetProperties())
+                ofs << " " << *i.first << " "
+                    << cmOutputConverter::EscapeForCMake(*i.second);
+            ofs << ")\n";
+        }
+        _generator.GenerateProperties(ofs);
+        ++_count;
+    }
+    return _count;
+}
+//----------------------------------------------------------------------------//
+// if "dir" contains a manifest but no CTestTestfile.cmake (e.g. only the
+// smaller manifest was kept or shipped), regenerate CTestTestfile.cmake from
+// the manifest without going through Python. The manifest holds the tests
+// as they were registered so the file has none of the derived properties,
+// batches, or cached tests of a run. CTest itself always reads
+// CTestTestfile.cmake
+void
+sync_test_manifest(string_t dir = "")
+{
+    string_t mname = "CTestTestfile.manifest";
+    string_t fname = "CTestTestfile.cmake";
+    if(!dir.empty())
+    {
+        mname = dir + "/" + mname;
+        fname = dir + "/" + fname;
+    }
+
+    if(!cmSystemTools::FileExists(mname) || cmSystemTools::FileExists(fname))
+        return;
+
+    pycmTestArena arena;
+    test_list_t   test_list;
+    if(load_test_manifest(mname, &test_list, &arena) > 0)
+        write_test_file(fname, &test_list, nullptr, false);
+}
+//----------------------------------------------------------------------------//
+// merge the CTestCostData.txt CTest wrote in "dir", the results and times (and
+// the CPU time and peak RSS measured by pyctest-launcher) of the tests in
+// LastTest.log, and the re-runs of the failed tests into the test history and,
+// if "fname" is not empty, save the history there. The tests whose time
+// drifted are reported
+void
+update_test_history(const string_t& dir, const string_t& fname = "")
+{
+    string_t tdir = "Testing/Temporary";
+    if(!dir.empty())
+        tdir = dir + "/" + tdir;
+
+    auto _history = get_test_history();
+    if(cmSystemTools::FileExists(tdir + "/CTestCostData.txt"))
+        _history->ReadCostData(tdir + "/CTestCostData.txt");
+
+    pycmTestHistory::result_map_t      _results;
+    pycmTestHistory::measurement_map_t _measurements;
+    pycmTestHistory::time_map_t        _times;
+    string_t _log = pycmTestHistory::FindTestLog(tdir);
+    if(!_log.empty())
+        pycmTestHistory::ReadTestLog(_log, _results, &_measurements, &_times);
+
+    // the CPU time is averaged over the same runs as the cost. The peak RSS
+    // is not averaged: a smaller peak only slowly replaces a larger one so a
+    // test is not scheduled by a run that happened to need less memory
+    for(const auto& itr : _measurements)
+    {
+        auto  _cpu    = itr.second.find("CPU Time");
+        auto  _rss    = itr.second.find("Peak RSS");
+        auto& _record = _history->Get(itr.first);
+        if(_cpu != itr.second.end())
+            _record.cpu =
+                (_record.cpu > 0.0 && _record.count > 1)
+                    ? (_record.cpu * (_record.count - 1) + _cpu->second) /
+                          _record.count
+                    : _cpu->second;
+        if(_rss != itr.second.end())
+            _record.memory = std::max(_rss->second, 0.9 * _record.memory);
+    }
+
+    // tests replaced by the cached command did not run
+    auto _incremental = get_incremental_tests();
+    pycmTestHistory::result_map_t _ran;
+    for(const auto& itr : _results)
+        if(!_incremental->IsReplaced(itr.first))
+            _ran.insert(itr);
+    _history->AddResults(_ran);
+
+    // report the tests whose time is more than twice (or less than half) the
+    // median of their recent runs, and by more than a second
+    std::stringstream _drift;
+    for(const auto& itr : _times)
+    {
+        if(_incremental->IsReplaced(itr.first))
+            continue;
+        auto&  _record = _history->Get(itr.first);
+        double _median = quantile(_record.times, 0.5);
+        if(_record.times.size() >= timeout_policy_t::MinRuns() &&
+           std::fabs(itr.second - _median) > 1.0 &&
+           (itr.second > 2.0 * _median || 2.0 * itr.second < _median))
+            _drift << "    " << std::setw(10) << std::setprecision(4)
+                   << _median << " s -> " << std::setw(10) << itr.second
+                   << " s  " << itr.first << "\n";
+        _record.AddTime(itr.second);
+    }
+    if(!_drift.str().empty())
+        std::cout << "\nTests whose time drifted from the median of their "
+                  << "recent runs:\n"
+                  << _drift.str() << std::endl;
+    // the re-runs are only counted once
+    string_t _reruns = tdir + "/PyCTestReruns.txt";
+    if(cmSystemTools::FileExists(_reruns) && _history->ReadReruns(_reruns))
+        cmSystemTools::RemoveFile(_reruns);
+
+    if(_incremental->NumPending() > 0)
+        _incremental->Update(_history, _results);
+
+    if(!fname.empty() && !_history->Write(fname))
+        std::cerr << __FUNCTION__ << ":: Error writing test history \""
+                  << fname << "\"!!!" << std::endl;
+}
+//----------------------------------------------------------------------------//
+// release every test of the session. Test list entries and Python wrappers
+// referring to the released tests are invalidated
+void
+reset_tests()
+{
+    test_list_t().swap(*get_test_list());
+    get_test_arena()->Clear();
+}
+//----------------------------------------------------------------------------//
+void
+pycmTestBatches::Build(test_list_t*                test_list,
+                       const test_template_list_t* templates,
+                       const test_filter_t&        filter,
+                       const string_t&             directory)
+{
+    Clear();
+    if(m_launcher.empty())
+        return;
+
+    struct group_t
+    {
+        string_t            protocol;
+        strvec_t            command;
+        string_t            directory;
+        string_t            environment;
+        strpair_list_t      schedule;
+        size_t              size;
+        strvec_t            names;
+        strvec_t            args;
+        std::vector<long>   processors;
+        std::vector<double> timeouts;  // 0: no timeout
+    };
+
+    auto property = [](const pycmTest* test, const string_t& prop) {
+        const char* _val = test->GetProperty(prop);
+        return (_val) ? string_t(_val) : string_t("");
+    };
+
+    // the properties of a case the batch shares with it, derived values
+    // (e.g. the locks of the limited labels) take precedence
+    auto scheduling = [&](const pycmTest* test) {
+        std::map<string_t, string_t> _props;
+        for(const char* prop :
+            { "FIXTURES_REQUIRED", "DEPENDS", "RESOURCE_LOCK", "RUN_SERIAL",
+              "PROCESSORS", "TIMEOUT" })
+            _props[prop] = property(test, prop);
+        for(const auto& itr : derive_test_properties(test))
+            if(_props.count(itr.first) > 0)
+                _props[itr.first] = itr.second;
+        return _props;
+    };
+    double _default_timeout = get_timeout_policy().limit;
+
+    // groups in the order of their first test
+    std::vector<group_t>       _groups;
+    std::map<string_t, size_t> _index;
+    auto                       _incremental = get_incremental_tests();
+    for_each_test(test_list, templates, [&](pycmTest* itr) {
+        string_t _protocol = property(itr, "PYCTEST_BATCH");
+        strvec_t _command  = itr->GetCommand();
+        if(_protocol.empty() || _command.size() < 2)
+            return;
+
+        string_t _size = property(itr, "PYCTEST_BATCH_SIZE");
+        size_t   _max  = (_size.empty())
+                          ? m_default_size
+                          : std::strtoul(_size.c_str(), nullptr, 10);
+        if(_max < 2 || (_incremental->Enabled() &&
+                        _incremental->IsCached(itr, get_test_history())))
+            return;
+
+        string_t _arg = _command.back();
+        _command.pop_back();
+        auto    _props = scheduling(itr);
+        group_t _group = { _protocol,
+                           _command,
+                           property(itr, "WORKING_DIRECTORY"),
+                           property(itr, "ENVIRONMENT"),
+                           {},
+                           _max,
+                           {},
+                           {},
+                           {},
+                           {} };
+        for(const char* prop :
+            { "FIXTURES_REQUIRED", "DEPENDS", "RESOURCE_LOCK", "RUN_SERIAL" })
+            if(!_props[prop].empty())
+                _group.schedule.push_back(strpair_t(prop, _props[prop]));
+
+        std::stringstream ss;
+        ss << _protocol << '\0' << _group.directory << '\0'
+           << _group.environment << '\0' << _max << '\0';
+        for(const auto& prop : _group.schedule)
+            ss << prop.first << '=' << prop.second << '\0';
+        for(const auto& arg : _command)
+            ss << arg << '\0';
+        auto _itr = _index.find(ss.str());
+        if(_itr == _index.end())
+        {
+            _itr = _index.insert({ ss.str(), _groups.size() }).first;
+            _groups.push_back(_group);
+        }
+        auto&  _entry   = _groups.at(_itr->second);
+        double _timeout = std::atof(_props["TIMEOUT"].c_str());
+        _entry.names.push_back(itr->GetName());
+        _entry.args.push_back(_arg);
+        _entry.processors.push_back(
+            std::max(std::atol(_props["PROCESSORS"].c_str()), 1L));
+        _entry.timeouts.push_back((_timeout > 0.0) ? _timeout
+                                                   : _default_timeout);
+    }, filter);
+
+    for(const auto& itr : _groups)
+    {
+        // a single test is not worth a batch
+        for(size_t i = 0; i + 1 < itr.names.size(); i += itr.size)
+        {
+            size_t   _n    = std::min(itr.size, itr.names.size() - i);
+            string_t _name = sanitize_test_name(
+                "pyctest_batch_" +
+                cmSystemTools::GetFilenameName(itr.command.front()) + "_" +
+                std::to_string(m_tests.size()));
+            string_t _results =
+                directory + "/Testing/Temporary/PyCTestBatch_" + _name + ".txt";
+
+            strvec_t _command = { m_launcher, "--batch", itr.protocol,
+                                  "--results", _results, "--cases",
+                                  std::to_string(_n), "--" };
+            _command.insert(_command.end(), itr.command.begin(),
+                            itr.command.end());
+            _command.insert(_command.end(), itr.args.begin() + i,
+                            itr.args.begin() + i + _n);
+
+            // the batch runs the cases one after the other: the largest
+            // PROCESSORS and the sum of the TIMEOUTs, unless a case has no
+            // timeout at all
+            long   _nproc   = 1;
+            double _timeout = 0.0;
+            bool   _timed   = true;
+            for(size_t j = i; j < i + _n; ++j)
+            {
+                _nproc = std::max(_nproc, itr.processors.at(j));
+                _timeout += itr.timeouts.at(j);
+                _timed = _timed && itr.timeouts.at(j) > 0.0;
+            }
+
+            auto _test = m_arena.Create(_name, _command);
+            _test->SetProperty("FIXTURES_SETUP", _name.c_str());
+            _test->SetProperty("LABELS", "batch");
+            if(!itr.directory.empty())
+                _test->SetProperty("WORKING_DIRECTORY", itr.directory.c_str());
+            if(!itr.environment.empty())
+                _test->SetProperty("ENVIRONMENT", itr.environment.c_str());
+            for(const auto& prop : itr.schedule)
+                _test->SetProperty(prop.first, prop.second.c_str());
+            if(_nproc > 1)
+                _test->SetProperty("PROCESSORS",
+                                   std::to_string(_nproc).c_str());
+            if(_timed)
+                _test->SetProperty(
+                    "TIMEOUT",
+                    std::to_string(std::lround(std::ceil(_timeout))).c_str());
+            m_tests.push_back(_test);
+
+            for(size_t j = i; j < i + _n; ++j)
+                m_members[itr.names.at(j)] = { _name, _results,
+                                               itr.args.at(j) };
+        }
+    }
+}
+//----------------------------------------------------------------------------//
+double
+pycmLabelLimits::Cost(const pycmTest* test)
+{
+    const char* _cost   = test->GetProperty("COST");
+    auto        _record = get_test_history()->Find(test->GetName());
+    if(_cost)
+        return std::atof(_cost);
+    return (_record && _record->cost > 0.0) ? _record->cost : 1.0;
+}
+//----------------------------------------------------------------------------//
+void
+pycmLabelLimits::Build(test_list_t*                test_list,
+                       const test_template_list_t* templates,
+                       const test_filter_t& filter, bool all)
+{
+    Clear();
+    if(m_limits.empty())
+        return;
+
+    struct entry_t
+    {
+        double   cost;
+        string_t name;
+    };
+
+    // tests of each limited label
+    std::map<string_t, std::vector<entry_t>> _tests;
+    for_each_test(test_list, templates, [&](pycmTest* itr) {
+        for(const auto& label : get_list_property(itr, "LABELS"))
+        {
+            if(m_limits.count(label) == 0)
+                continue;
+            entry_t _entry = { Cost(itr), itr->GetName() };
+            _tests[label].push_back(_entry);
+        }
+    }, filter);
+
+    for(auto& itr : _tests)
+    {
+        auto& _entries = itr.second;
+        std::stable_sort(_entries.begin(), _entries.end(),
+                         [](const entry_t& lhs, const entry_t& rhs) {
+                             return lhs.cost > rhs.cost;
+                         });
+
+        // with as many locks as tests the label is not limited
+        size_t _nlocks = m_limits.at(itr.first);
+        if(!all && _entries.size() <= _nlocks)
+            continue;
+
+        std::vector<double>& _load   = m_loads[itr.first];
+        string_t             _prefix = Prefix(itr.first);
+        _load.assign(_nlocks, 0.0);
+        for(const auto& entry : _entries)
+        {
+            size_t _idx =
+                std::min_element(_load.begin(), _load.end()) - _load.begin();
+            _load.at(_idx) += entry.cost;
+            m_locks[entry.name].push_back(_prefix + std::to_string(_idx));
+        }
+    }
+}
+//----------------------------------------------------------------------------//
+strvec_t
+pycmLabelLimits::Assign(const pycmTest* test)
+{
+    strvec_t _locks;
+    for(const auto& label : get_list_property(test, "LABELS"))
+    {
+        auto _limit = m_limits.find(label);
+        if(_limit == m_limits.end())
+            continue;
+        std::vector<double>& _load = m_loads[label];
+        if(_load.empty())
+            _load.assign(_limit->second, 0.0);
+        size_t _idx =
+            std::min_element(_load.begin(), _load.end()) - _load.begin();
+        _load.at(_idx) += Cost(test);
+        _locks.push_back(Prefix(label) + std::to_string(_idx));
+    }
+    return _locks;
+}
+//----------------------------------------------------------------------------//
+// re-run of the slow tests under a profiler command (see profile_slow_tests in
+// Init.cmake): a test is slow when its time exceeds "factor" times the median
+// of its recent runs and the median by "floor" seconds. Disabled with a factor
+// of zero or without a command
+struct profile_policy_t
+{
+    profile_policy_t()
+    : factor(0.0)
+    , floor(1.0)
+    {
+    }
+
+    double   factor;
+    double   floor;
+    strvec_t command;
+};
+//----------------------------------------------------------------------------//
+profile_policy_t&
+get_profile_policy()
+{
+    static profile_policy_t _instance;
+    return _instance;
+}
+//----------------------------------------------------------------------------//
+// PyCTestProfile.cmake, read by profile_slow_tests after the tests ran:
+//
+//      set(PYCTEST_PROFILE_COMMAND <command>...)
+//      pyctest_profile_test(<name> <threshold> <directory> <environment>
+//                           <command>...)
+//
+// with one pyctest_profile_test per test with enough recent run times.
+// Benchmarks and batches are profiled without pyctest-launcher, fuzz targets
+// and the tests run in a batch are skipped. As in any CMake list, the
+// arguments cannot contain ';'. The file is removed when the profiling is
+// disabled
+void
+write_profile_file(const string_t& fname, test_list_t* test_list,
+                   const test_template_list_t* templates,
+                   const string_t& test_dir, const test_filter_t& filter = {})
+{
+    const profile_policy_t& _policy = get_profile_policy();
+    if(_policy.factor <= 0.0 || _policy.command.empty())
+    {
+        if(cmSystemTools::FileExists(fname))
+            cmSystemTools::RemoveFile(fname);
+        return;
+    }
+
+    std::ofstream ofs(fname.c_str());
+    if(!ofs)
+    {
+        std::cerr << __FUNCTION__ << ":: Error opening " << fname << "!!!"
+                  << std::endl;
+        return;
+    }
+
+    auto escape = [](const string_t& val) {
+        return cmOutputConverter::EscapeForCMake(val);
+    };
+
+    ofs << "set(PYCTEST_PROFILE_COMMAND";
+    for(const auto& itr : _policy.command)
+        ofs << " " << escape(itr);
+    ofs << ")\n";
+
+    auto _history = get_test_history();
+    auto _batches = get_test_batches();
+    for_each_test(test_list, templates,
+                  [&](pycmTest* itr) {
+                      auto _record = _history->Find(itr->GetName());
+                      if(!_record ||
+                         _record->times.size() < timeout_policy_t::MinRuns() ||
+                         _batches->Find(itr->GetName()) ||
+                         is_fuzz_target(itr->GetCommand()))
+                          return;
+                      strvec_t _cmd = strip_launcher(itr->GetCommand());
+                      if(_cmd.empty())
+                          return;
+
+                      double _median = quantile(_record->times, 0.5);
+                      double _limit  = std::max(_policy.factor * _median,
+                                               _median + _policy.floor);
+                      const char* _wdir = itr->GetProperty("WORKING_DIRECTORY");
+                      string_t    _env;
+                      for(const auto& env :
+                          get_list_property(itr, "ENVIRONMENT"))
+                          _env += (_env.empty()) ? env : ";" + env;
+
+                      ofs << "pyctest_profile_test(" << escape(itr->GetName())
+                          << " " << _limit << " "
+                          << escape((_wdir && *_wdir) ? string_t(_wdir)
+                                                      : test_dir)
+                          << " " << escape(_env);
+                      for(const auto& arg : _cmd)
+                          ofs << " " << escape(arg);
+                      ofs << ")\n";
+                  },
+                  filter);
+}
+//----------------------------------------------------------------------------//
+// generate the test file for every test or only for the tests affected by
+// the changed files (see pycmTestSelection), if "shard_count" > 1, only for
+// the tests of shard "shard_index" (see shard_tests) and, if "time_budget" >
+// 0, only for the tests planned to run within it on "jobs" (see plan_tests).
+// The slow tests of the run can be profiled (see write_profile_file). The
+// tests of "source" are written after the others as they are produced (see
+// write_streamed_tests). They are not known in advance so they cannot be
+// selected, sharded, planned, batched, or profiled
+void
+generate_test_file(string_t dir = "", bool manifest = false,
+                   size_t shard_index = 0, size_t shard_count = 1,
+                   double time_budget = 0.0, size_t jobs = 1,
+                   const test_source_t& source = test_source_t())
+{
+    if(shard_count > 1 && shard_index >= shard_count)
+        throw std::runtime_error("generate_test_file: the shard index must be "
+                                 "less than the number of shards");
+    if(source && (shard_count > 1 || time_budget > 0.0 ||
+                  get_test_selection()->Enabled()))
+        throw std::runtime_error("generate_test_file: the tests of a source "
+                                 "cannot be selected, sharded, or planned");
+
+    string_t fname = "CTestTestfile.cmake";
+    string_t mname = "CTestTestfile.manifest";
+    string_t pname = "PyCTestProfile.cmake";
+    configure_filepath(dir, fname);
+    configure_filepath(dir, mname);
+    configure_filepath(dir, pname);
+
+    auto test_list = get_test_list();
+    auto templates = &get_test_arena()->Templates();
+    if(!source && count_tests(test_list, templates) == 0)
+    {
+        std::cerr << __FUNCTION__ << ":: Warning! No tests to generate!!!"
+                  << std::endl;
+    }
+    else
+    {
+        test_filter_t filter;
+        auto          selection = get_test_selection();
+        if(selection->Enabled())
+        {
+            auto affected = std::make_shared<std::set<string_t>>(
+                selection->Select(test_list, templates));
+            filter = [=](const pycmTest* itr) {
+                return affected->count(itr->GetName()) > 0;
+            };
+        }
+
+        if(shard_count > 1)
+        {
+            auto shard = std::make_shared<std::set<string_t>>(
+                shard_tests(test_list, templates, shard_index, shard_count,
+                            true, filter));
+            filter = [=](const pycmTest* itr) {
+                return shard->count(itr->GetName()) > 0;
+            };
+        }
+
+        if(time_budget > 0.0)
+        {
+            auto plan = std::make_shared<std::set<string_t>>(plan_tests(
+                test_list, templates, time_budget, jobs, true, filter));
+            filter = [=](const pycmTest* itr) {
+                return plan->count(itr->GetName()) > 0;
+            };
+        }
+
+        get_label_limits()->Build(test_list, templates, filter,
+                                  static_cast<bool>(source));
+
+        // the setup tests of the batches are written before the tests
+        auto        batches  = get_test_batches();
+        string_t    test_dir = cmSystemTools::CollapseFullPath(
+            (dir.empty()) ? string_t(".") : dir);
+        test_list_t _tests;
+        batches->Build(test_list, templates, filter, test_dir);
+        if(!batches->Tests()->empty())
+        {
+            auto _setups = std::make_shared<std::set<string_t>>();
+            for(auto itr : *batches->Tests())
+                _setups->insert(itr->GetName());
+            _tests = *batches->Tests();
+            _tests.insert(_tests.end(), test_list->begin(), test_list->end());
+            test_list = &_tests;
+
+            test_filter_t _filter = filter;
+            if(_filter)
+                filter = [=](const pycmTest* itr) {
+                    return _setups->count(itr->GetName()) > 0 || _filter(itr);
+                };
+        }
+
+        // the registered tests, without the setup tests of the batches
+        if(manifest)
+            write_test_manifest(mname, get_test_list(), templates, filter);
+        write_test_file(fname, test_list, templates, true, filter);
+        if(source)
+            write_streamed_tests(fname, (manifest) ? mname : string_t(""),
+                                 source);
+        write_profile_file(pname, test_list, templates, test_dir, filter);
+        batches->Clear();
+        get_label_limits()->Clear();
+    }
+}
+//----------------------------------------------------------------------------//
+//
+//  Test discovery
+//
+//----------------------------------------------------------------------------//
+// output of --gtest_list_tests:
+//
+//      Suite.
+//        Case
+//      Instance/Suite.  # TypeParam = int
+//        Case/0  # GetParam() = 4
+//
+strvec_t
+parse_gtest_list(const string_t& output)
+{
+    strvec_t _cases;
+    string_t _suite;
+    for(auto _line : split_lines(output))
+    {
+        auto _comment = _line.find("  #");
+        if(_comment != string_t::npos)
+            _line = _line.substr(0, _comment);
+        while(!_line.empty() && isspace(_line.back()))
+            _line.pop_back();
+        if(_line.empty())
+            continue;
+
+        if(_line[0] != ' ')
+        {
+            // anything else (e.g. "Running main() from ...") is not a suite
+            _suite = (_line.back() == '.') ? _line : string_t("");
+            continue;
+        }
+        if(!_suite.empty())
+            _cases.push_back(_suite +
+                             _line.substr(_line.find_first_not_of(' ')));
+    }
+    return _cases;
+}
+//----------------------------------------------------------------------------//
+// output of --list-test-names-only (Catch2 v2) or of --list-tests
+// --verbosity quiet (Catch2 v3): one test case per line
+strvec_t
+parse_catch2_list(const string_t& output)
+{
+    strvec_t _cases;
+    for(const auto& _line : split_lines(output))
+        if(!_line.empty())
+            _cases.push_back(_line);
+    return _cases;
+}
+//----------------------------------------------------------------------------//
+// register one test per test case of GoogleTest ("gtest") or Catch2
+// ("catch2") executables. The executables are listed concurrently with up to
+// "jobs" threads and the tests are created in the order of "executables".
+// The tests are named "<prefix><case>" where the prefix defaults to the name
+// of the executable without extension followed by a period. A name that is
+// already used by another test is an error. With "batch" > 1, the tests are
+// run "batch" cases per process (see pycmTestBatches). Test cases of
+// GoogleTest named DISABLED_* are registered with the DISABLED property (and
+// left out of batches)
+std::vector<pycmTest*>
+discover_tests(const strvec_t& executables, const string_t& framework,
+               size_t jobs, const string_t& prefix, const strvec_t& args,
+               size_t batch = 1)
+{
+    bool _gtest = (framework == "gtest");
+    if(!_gtest && framework != "catch2")
+        throw std::runtime_error("discover_tests: framework must be \"gtest\" "
+                                 "or \"catch2\"");
+
+    jobs  = std::min<size_t>(std::max<size_t>(jobs, 1), executables.size());
+    batch = std::max<size_t>(batch, 1);
+
+    // std::vector<bool> is not safe to write from several threads
+    std::vector<strvec_t> _cases(executables.size());
+    std::vector<char>     _listed(executables.size(), 0);
+    std::atomic<size_t>   _next(0);
+    auto                  _worker = [&]() {
+        for(size_t i = _next++; i < executables.size(); i = _next++)
+        {
+            string_t _output;
+            strvec_t _cmd = { executables.at(i) };
+            _cmd.push_back((_gtest) ? "--gtest_list_tests"
+                                    : "--list-test-names-only");
+            // Catch2 v2 exits with the number of test cases listed
+            _listed[i] = (capture_output(_cmd, _output)) ? 1 : 0;
+            _cases[i]  = (_gtest) ? parse_gtest_list(_output)
+                                 : parse_catch2_list(_output);
+            // Catch2 v3 rejects --list-test-names-only
+            if(!_gtest && !_listed[i] &&
+               (_cases[i].empty() ||
+                _output.find("Error(s) in input") != string_t::npos))
+            {
+                _output.clear();
+                _cmd = { executables.at(i), "--list-tests", "--verbosity",
+                         "quiet" };
+                _listed[i] = (capture_output(_cmd, _output)) ? 1 : 0;
+                _cases[i]  = parse_catch2_list(_output);
+            }
+        }
+    };
+
+    std::vector<std::future<void>> _futures;
+    for(size_t i = 0; i < jobs; ++i)
+        _futures.push_back(std::async(std::launch::async, _worker));
+    for(auto& itr : _futures)
+        itr.get();
+
+    // "a.b" and "a,b" filters select several cases of one executable
+    auto filter_arg = [&](const strvec_t& _names) {
+        std::stringstream ss;
+        for(size_t i = 0; i < _names.size(); ++i)
+        {
+            ss << ((i > 0) ? ((_gtest) ? ":" : ",") : "");
+            if(_gtest)
+            {
+                ss << _names[i];
+                continue;
+            }
+            for(char c : _names[i])
+            {
+                if(c == ',' || c == '[' || c == ']' || c == '\\')
+                    ss << '\\';
+                ss << c;
+            }
+        }
+        return (_gtest) ? ("--gtest_filter=" + ss.str()) : ss.str();
+    };
+
+    auto is_disabled = [&](const string_t& _name) {
+        return _gtest && (_name.find("DISABLED_") == 0 ||
+                          _name.find(".DISABLED_") != string_t::npos);
+    };
+
+    // e.g. two executables with a test case of the same name
+    std::set<string_t> _names;
+    for(auto itr : *get_test_list())
+        _names.insert(itr->GetName());
+
+    auto                   arena = get_test_arena();
+    std::vector<pycmTest*> _tests;
+    for(size_t i = 0; i < executables.size(); ++i)
+    {
+        const string_t& _exe    = executables.at(i);
+        string_t        _prefix = prefix;
+        if(_prefix.empty())
+            _prefix =
+                cmSystemTools::GetFilenameWithoutLastExtension(_exe) + ".";
+        if(!_listed[i] && _cases[i].empty())
+        {
+            std::cerr << __FUNCTION__ << ":: Warning! Unable to list the tests "
+                      << "of \"" << _exe << "\"" << std::endl;
+            continue;
+        }
+
+        strvec_t _cmd = { _exe };
+        _cmd.insert(_cmd.end(), args.begin(), args.end());
+
+        for(const auto& itr : _cases[i])
+        {
+            strvec_t _case_cmd = _cmd;
+            _case_cmd.push_back(filter_arg({ itr }));
+            string_t _name = sanitize_test_name(_prefix + itr);
+            if(!_names.insert(_name).second)
+                throw std::runtime_error(
+                    "discover_tests: the test \"" + _name + "\" of \"" + _exe +
+                    "\" already exists (use another prefix)");
+            auto _test = arena->Create(_name, _case_cmd);
+            if(is_disabled(itr))
+                _test->SetProperty("DISABLED", "ON");
+            else if(batch > 1)
+            {
+                _test->SetProperty("PYCTEST_BATCH", framework.c_str());
+                _test->SetProperty("PYCTEST_BATCH_SIZE",
+                                   std::to_string(batch).c_str());
+            }
+            _tests.push_back(_test);
+        }
+    }
+    return _tests;
+}
+//----------------------------------------------------------------------------//
+// quantile of the standard normal distribution (Acklam's rational
+// approximation, relative error < 1.2e-9)
+double
+normal_quantile(double p)
+{
+    static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02,
+                                -2.759285104469687e+02, 1.383577518672690e+02,
+                                -3.066479806614716e+01, 2.506628277459239e+00 };
+    static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02,
+                                -1.556989798598866e+02, 6.680131188771972e+01,
+                                -1.328068155288572e+01 };
+    static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01,
+                                -2.400758277161838e+00, -2.549732539343734e+00,
+                                4.374664141464968e+00,  2.938163982698783e+00 };
+    static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01,
+                                2.445134137142996e+00, 3.754408661907416e+00 };
+
+    auto tail = [&](double q) {
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q +
+                c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    };
+
+    p = std::min(std::max(p, 1.0e-300), 1.0 - 1.0e-16);
+    if(p < 0.02425)
+        return tail(std::sqrt(-2.0 * std::log(p)));
+    if(p > 1.0 - 0.02425)
+        return -tail(std::sqrt(-2.0 * std::log(1.0 - p)));
+
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r +
+            a[5]) *
+           q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+//----------------------------------------------------------------------------//
+// quantile of Student's t distribution (Cornish-Fisher expansion around the
+// normal quantile, Abramowitz & Stegun 26.7.5; within 1% for dof >= 2)
+double
+student_t_quantile(double p, double dof)
+{
+    double z  = normal_quantile(p);
+    double z2 = z * z;
+    double g1 = (z2 + 1.0) * z / 4.0;
+    double g2 = ((5.0 * z2 + 16.0) * z2 + 3.0) * z / 96.0;
+    double g3 = (((3.0 * z2 + 19.0) * z2 + 17.0) * z2 - 15.0) * z / 384.0;
+    double g4 =
+        ((((79.0 * z2 + 776.0) * z2 + 1482.0) * z2 - 1920.0) * z2 - 945.0) *
+        z / 92160.0;
+    return z + g1 / dof + g2 / (dof * dof) + g3 / (dof * dof * dof) +
+           g4 / (dof * dof * dof * dof);
+}
+//----------------------------------------------------------------------------//
+// "0,2-3" -> { 0, 2, 3 }
+std::vector<int>
+parse_cpu_list(const string_t& str)
+{
+    std::vector<int>  _cpus;
+    std::stringstream ss(str);
+    string_t          _item;
+    while(std::getline(ss, _item, ','))
+    {
+        int               _lo = 0, _hi = 0;
+        char              _dash;
+        std::stringstream is(_item);
+        if(!(is >> _lo))
+            throw std::runtime_error("invalid CPU list: \"" + str + "\"");
+        _hi = _lo;
+        if(is >> _dash && (_dash != '-' || !(is >> _hi)))
+            throw std::runtime_error("invalid CPU list: \"" + str + "\"");
+        for(int i = _lo; i <= _hi; ++i)
+            _cpus.push_back(i);
+    }
+    return _cpus;
+}
+//----------------------------------------------------------------------------//
+// result of the A/B comparison of a test. The speedup is the geometric mean
+// of the baseline/candidate time ratios of the paired runs (> 1 = the
+// candidate is faster) with its confidence interval [lower, upper]
+struct pycmComparison
+{
+    pycmComparison()
+    : speedup(0.0)
+    , lower(0.0)
+    , upper(0.0)
+    {
+    }
+
+    string_t            name;
+    std::vector<double> baseline;   // seconds
+    std::vector<double> candidate;  // seconds
+    string_t            error;      // why the comparison failed
+    double              speedup;
+    double              lower;
+    double              upper;
+};
+
+typedef std::vector<pycmComparison> comparison_list_t;
+//----------------------------------------------------------------------------//
+// replace the directory "from" by "to" in a path (or an argument containing
+// paths, e.g. "--input=/path/file")
+string_t
+replace_directory(string_t arg, const string_t& from, const string_t& to)
+{
+    if(from.empty())
+        return arg;
+    for(size_t pos = arg.find(from); pos != string_t::npos;
+        pos        = arg.find(from, pos))
+    {
+        size_t end = pos + from.length();
+        if(end < arg.length() && arg[end] != '/' && arg[end] != '\\')
+        {
+            pos = end;
+            continue;
+        }
+        arg.replace(pos, from.length(), to);
+        pos += to.length();
+    }
+    return arg;
+}
+//----------------------------------------------------------------------------//
+// run the registered tests, whose commands and working directories refer to
+// "test_dir", in "baseline_dir" and in "candidate_dir" (the same command with
+// the directory replaced) "repeat" times each. The runs of a test alternate
+// between the trees in ABBA order on the same CPUs so slow drifts of the
+// machine (thermal, frequency, background load) affect both trees equally.
+// The ENVIRONMENT of a test is applied to both runs, with "test_dir" replaced
+// as in the command. Benchmarks (see pyctest.benchmark) are run without their
+// launcher, fuzz targets are skipped.
+comparison_list_t
+compare_trees(test_list_t* test_list, const test_template_list_t* templates,
+              const string_t& test_dir, const string_t& baseline_dir,
+              const string_t& candidate_dir, size_t repeat,
+              const std::vector<int>& cpus, double confidence,
+              bool verbose = true, const test_filter_t& filter = {})
+{
+    struct ab_test_t
+    {
+        string_t name;
+        strvec_t command;
+        string_t directory;
+        strvec_t environment;
+    };
+
+    std::vector<ab_test_t> _tests;
+    for_each_test(test_list, templates,
+                  [&](pycmTest* itr) {
+                      if(is_fuzz_target(itr->GetCommand()))
+                          return;
+                      strvec_t _cmd = strip_launcher(itr->GetCommand());
+                      if(_cmd.empty())
+                          return;
+                      const char* _wdir = itr->GetProperty("WORKING_DIRECTORY");
+                      _tests.push_back(
+                          { itr->GetName(), _cmd,
+                            (_wdir && *_wdir) ? string_t(_wdir) : test_dir,
+                            get_list_property(itr, "ENVIRONMENT") });
+                  },
+                  filter);
+
+#if defined(_LINUX)
+    for(auto cpu : cpus)
+        if(cpu < 0 || cpu >= CPU_SETSIZE)
+            throw std::runtime_error("compare_trees: invalid CPU " +
+                                     std::to_string(cpu));
+
+    // the children inherit the CPU affinity of this process, the original
+    // affinity is restored when leaving this function (also on exceptions)
+    struct affinity_guard_t
+    {
+        cpu_set_t mask;
+        bool      pinned = false;
+        ~affinity_guard_t()
+        {
+            if(pinned)
+                sched_setaffinity(0, sizeof(mask), &mask);
+        }
+    } _affinity;
+
+    if(!cpus.empty() &&
+       sched_getaffinity(0, sizeof(_affinity.mask), &_affinity.mask) == 0)
+    {
+        cpu_set_t _mask;
+        CPU_ZERO(&_mask);
+        for(auto cpu : cpus)
+            CPU_SET(cpu, &_mask);
+        _affinity.pinned = (sched_setaffinity(0, sizeof(_mask), &_mask) == 0);
+    }
+#else
+    if(!cpus.empty())
+        std::cerr << __FUNCTION__ << ":: Warning! CPU pinning is not supported"
+                  << std::endl;
+#endif
+
+    typedef std::chrono::steady_clock     clock_type;
+    typedef std::chrono::duration<double> seconds_type;
+
+    // seconds or -1 if the run failed
+    auto run = [](const strvec_t& _cmd, const string_t& _dir,
+                  const strvec_t& _env, string_t& _error) {
+        cmSystemTools::SaveRestoreEnvironment _restore;
+        cmSystemTools::AppendEnv(_env);
+        pycmExecuteProcessCommand _proc(_cmd);
+        _proc.working_directory(_dir);
+        _proc.output_quiet(true);
+        _proc.error_quiet(true);
+        auto _beg = clock_type::now();
+        bool _ok  = _proc();
+        auto _end = clock_type::now();
+        if(!_ok || _proc.result() != "0")
+        {
+            _error = (_ok) ? _proc.result() : string_t("cannot run command");
+            return -1.0;
+        }
+        return seconds_type(_end - _beg).count();
+    };
+
+    comparison_list_t _results;
+    for(const auto& itr : _tests)
+    {
+        pycmComparison _cmp;
+        _cmp.name = itr.name;
+
+        strvec_t _cmd_a;
+        strvec_t _cmd_b;
+        for(const auto& arg : itr.command)
+        {
+            _cmd_a.push_back(replace_directory(arg, test_dir, baseline_dir));
+            _cmd_b.push_back(replace_directory(arg, test_dir, candidate_dir));
+        }
+        string_t _dir_a =
+            replace_directory(itr.directory, test_dir, baseline_dir);
+        string_t _dir_b =
+            replace_directory(itr.directory, test_dir, candidate_dir);
+        strvec_t _env_a;
+        strvec_t _env_b;
+        for(const auto& var : itr.environment)
+        {
+            _env_a.push_back(replace_directory(var, test_dir, baseline_dir));
+            _env_b.push_back(replace_directory(var, test_dir, candidate_dir));
+        }
+
+        if(verbose)
+            std::cout << "Comparing \"" << itr.name << "\"..." << std::endl;
+
+        for(size_t i = 0; i < repeat && _cmp.error.empty(); ++i)
+        {
+            // ABBA: A B B A A B B A ...
+            bool _a_first = ((i + 1) / 2) % 2 == 0;
+            for(int j = 0; j < 2 && _cmp.error.empty(); ++j)
+            {
+                bool     _a = (j == 0) == _a_first;
+                string_t _err;
+                double   _t = (_a) ? run(_cmd_a, _dir_a, _env_a, _err)
+                                 : run(_cmd_b, _dir_b, _env_b, _err);
+                if(_t < 0.0)
+                    _cmp.error = string_t((_a) ? "baseline" : "candidate") +
+                                 " run failed: " + _err;
+                else
+                    ((_a) ? _cmp.baseline : _cmp.candidate).push_back(_t);
+            }
+        }
+
+        // mean and confidence interval of the log of the paired ratios
+        size_t n = _cmp.baseline.size();
+        if(_cmp.error.empty() && n > 0)
+        {
+            std::vector<double> _logs;
+            for(size_t i = 0; i < n; ++i)
+                _logs.push_back(std::log(std::max(_cmp.baseline[i], 1.0e-9) /
+                                         std::max(_cmp.candidate[i], 1.0e-9)));
+            double _mean = 0.0;
+            for(auto v : _logs)
+                _mean += v / n;
+            double _var = 0.0;
+            for(auto v : _logs)
+                _var += (v - _mean) * (v - _mean) / std::max<double>(n - 1, 1);
+            double _half =
+                (n > 1) ? student_t_quantile(0.5 + 0.5 * confidence, n - 1) *
+                              std::sqrt(_var / n)
+                        : std::numeric_limits<double>::infinity();
+            _cmp.speedup = std::exp(_mean);
+            _cmp.lower   = std::exp(_mean - _half);
+            _cmp.upper   = std::exp(_mean + _half);
+        }
+        _results.push_back(_cmp);
+    }
+
+    return _results;
+}
+//----------------------------------------------------------------------------//
+// run each test "count" times, "jobs" at a time (0 = one per CPU), with
+// pyctest-launcher --stress (see pycmLauncher.cpp) in its working directory
+// ("test_dir" if not set) and with its ENVIRONMENT. Run i of a test gets
+// PYCTEST_STRESS_SEED = "seed" + i (a random seed if "seed" is 0) and starts
+// after a random delay of up to "jitter" milliseconds. Unless "keep_going"
+// is set, the runs of a test stop at its first failure. Returns the names of
+// the tests that failed. Fuzz targets are skipped
+strvec_t
+stress_tests(test_list_t* test_list, const test_template_list_t* templates,
+             const string_t& launcher, const string_t& test_dir, size_t count,
+             size_t jobs, uint64_t seed, double jitter, bool keep_going,
+             const test_filter_t& filter = {})
+{
+    struct stress_test_t
+    {
+        string_t name;
+        strvec_t command;
+        string_t directory;
+        strvec_t environment;
+    };
+
+    std::vector<stress_test_t> _tests;
+    for_each_test(test_list, templates,
+                  [&](pycmTest* itr) {
+                      if(is_fuzz_target(itr->GetCommand()))
+                          return;
+                      strvec_t _cmd = strip_launcher(itr->GetCommand());
+                      if(_cmd.empty())
+                          return;
+                      const char* _wdir = itr->GetProperty("WORKING_DIRECTORY");
+                      _tests.push_back(
+                          { itr->GetName(), _cmd,
+                            (_wdir && *_wdir) ? string_t(_wdir) : test_dir,
+                            get_list_property(itr, "ENVIRONMENT") });
+                  },
+                  filter);
+
+    strvec_t _failed;
+    for(const auto& itr : _tests)
+    {
+        strvec_t _cmd = { launcher, "--stress", std::to_string(count) };
+        if(jobs > 0)
+            _cmd.insert(_cmd.end(), { "--jobs", std::to_string(jobs) });
+        if(seed > 0)
+            _cmd.insert(_cmd.end(), { "--seed", std::to_string(seed) });
+        if(jitter > 0.0)
+            _cmd.insert(_cmd.end(), { "--jitter", std::to_string(jitter) });
+        if(keep_going)
+            _cmd.push_back("--keep-going");
+        _cmd.push_back("--");
+        _cmd.insert(_cmd.end(), itr.command.begin(), itr.command.end());
+
+        std::cout << "Stress testing \"" << itr.name << "\"..." << std::endl;
+
+        cmSystemTools::SaveRestoreEnvironment _restore;
+        cmSystemTools::AppendEnv(itr.environment);
+
+        pycmExecuteProcessCommand _proc(_cmd);
+        _proc.working_directory(itr.directory);
+        _proc.output_quiet(false);
+        _proc.error_quiet(false);
+        if(!_proc() || _proc.result() != "0")
+            _failed.push_back(itr.name);
+    }
+    return _failed;
+}
+//----------------------------------------------------------------------------//
+// table of the comparisons
+void
+report_comparisons(std::ostream& os, const comparison_list_t& results,
+                   double confidence)
+{
+    auto median = [](std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        auto n = v.size();
+        return (n == 0) ? 0.0
+                        : (n % 2 == 1) ? v[n / 2]
+                                       : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    };
+
+    size_t _width = 4;
+    for(const auto& itr : results)
+        _width = std::max(_width, itr.name.length());
+
+    std::stringstream ss;
+    ss << std::left << std::setw(_width) << "Test" << std::right << "  "
+       << std::setw(12) << "baseline (s)" << "  " << std::setw(13)
+       << "candidate (s)" << "  " << std::setw(8) << "speedup" << "  "
+       << std::setprecision(3) << 100.0 * confidence << "% interval\n";
+    for(const auto& itr : results)
+    {
+        ss << std::left << std::setw(_width) << itr.name << std::right;
+        if(!itr.error.empty())
+        {
+            ss << "  " << itr.error << "\n";
+            continue;
+        }
+        const char* _verdict = (itr.lower > 1.0)
+                                   ? "faster"
+                                   : (itr.upper < 1.0) ? "slower" : "no change";
+        ss << std::fixed << std::setprecision(4) << "  " << std::setw(12)
+           << median(itr.baseline) << "  " << std::setw(13)
+           << median(itr.candidate) << "  " << std::setprecision(3)
+           << std::setw(7) << itr.speedup << "x  [" << itr.lower << ", "
+           << itr.upper << "]  " << _verdict << "\n"
+           << std::defaultfloat;
     }
+    os << ss.str() << std::flush;
 }
 //----------------------------------------------------------------------------//
 